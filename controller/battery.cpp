@@ -1,64 +1,367 @@
 #include <algorithm>
 
+#include <ADC.h>
 #include <TimeLib.h>
 
 #include "battery.h"
 #include "utils.h"
 
 namespace {
+#if defined(KINETISK)
 // Remember when the battery history was last updated using a location in NVRAM
 // to minimize wear on the flash memory.
-constexpr volatile uint32_t* LAST_SAMPLE_INDEX = reinterpret_cast<volatile uint32_t*>(0x4003E000);
+volatile uint32_t* const LAST_SAMPLE_INDEX = reinterpret_cast<volatile uint32_t*>(0x4003E000);
+
+// Likewise accumulate the charge log for the current period in NVRAM and only
+// write it to the EEPROM once the period is over.
+volatile uint32_t* const CHARGE_LOG_PERIOD = reinterpret_cast<volatile uint32_t*>(0x4003E004);
+volatile uint32_t* const CHARGE_LOG_SECONDS = reinterpret_cast<volatile uint32_t*>(0x4003E008);
+#else
+// Simulated builds have no VBAT register file so keep these in RAM.
+volatile uint32_t vbatRegisters[3] = {};
+volatile uint32_t* const LAST_SAMPLE_INDEX = &vbatRegisters[0];
+volatile uint32_t* const CHARGE_LOG_PERIOD = &vbatRegisters[1];
+volatile uint32_t* const CHARGE_LOG_SECONDS = &vbatRegisters[2];
+#endif
+
+// The charge log's period is stored plus one so that zero means there is none.
+// Its seconds spent charging are in the low half and on external power in the high half.
+constexpr uint32_t CHARGE_LOG_POWERED_SHIFT = 16;
+constexpr uint32_t CHARGE_LOG_CHARGING_MASK = (1UL << CHARGE_LOG_POWERED_SHIFT) - 1;
+
+// Packs the minutes spent charging and on external power into a byte of the log.
+uint8_t packChargeMinutes(uint32_t seconds) {
+  const uint32_t charging = std::min<uint32_t>((seconds & CHARGE_LOG_CHARGING_MASK) / 60, 15);
+  const uint32_t powered = std::min<uint32_t>((seconds >> CHARGE_LOG_POWERED_SHIFT) / 60, 15);
+  return uint8_t(powered << 4 | charging);
+}
+
+// Delta nibble that marks a missing sample.
+// The remaining nibbles encode deltas from -7 to +7 in two's complement.
+constexpr uint8_t MISSING = 0x8;
+constexpr int32_t MAX_DELTA = 7;
+
+ADC adc;
+
+millivolt_t toMillivolts(int value) {
+  constexpr uint32_t vref = 3310; // 3.310 V, doubled by the voltage divider
+  return millivolt_t(value * vref / 2047);
+}
+
+uint8_t toLevel(millivolt_t voltage) {
+  return voltage <= 3000 ? 0 : voltage >= 5550 ? 255 : uint8_t((voltage - 3000) / 10);
+}
+
+// Open circuit voltage of a typical LiPo cell at every 10% state of charge.
+constexpr millivolt_t CHARGE_CURVE[] = {
+  3300, 3600, 3690, 3740, 3770, 3800, 3850, 3920, 4000, 4080, 4200
+};
+constexpr unsigned CHARGE_CURVE_STEPS = sizeof(CHARGE_CURVE) / sizeof(CHARGE_CURVE[0]) - 1;
+
+// The charging current raises the voltage by roughly this much.
+constexpr millivolt_t CHARGING_VOLTAGE_RISE = 100;
+
+// Time constant for smoothing the estimate in seconds.
+constexpr time_t CHARGE_TIME_CONSTANT = 600;
+
+// Returns how much of the difference from the target remains after smoothing
+// for the given number of seconds, exp(-seconds / CHARGE_TIME_CONSTANT),
+// with 30 fractional bits.
+uint64_t chargeDecay(uint32_t seconds) {
+  constexpr uint64_t ONE = 1ULL << 30;
+  uint64_t decay = ONE;
+  uint64_t step = ONE - (ONE + CHARGE_TIME_CONSTANT / 2) / CHARGE_TIME_CONSTANT; // per second
+  while (seconds) {
+    if (seconds & 1) decay = (decay * step + ONE / 2) >> 30;
+    step = (step * step + ONE / 2) >> 30;
+    seconds >>= 1;
+  }
+  return decay;
 }
 
+// Returns the state of charge in percent with 8 fractional bits.
+uint32_t chargeFromVoltage(uint32_t voltage) {
+  if (voltage <= CHARGE_CURVE[0]) return 0;
+  for (unsigned i = 1; i <= CHARGE_CURVE_STEPS; i++) {
+    if (voltage < CHARGE_CURVE[i]) {
+      uint32_t fraction = (voltage - CHARGE_CURVE[i - 1]) * 256 * 10
+          / (CHARGE_CURVE[i] - CHARGE_CURVE[i - 1]);
+      return (i - 1) * 10 * 256 + fraction;
+    }
+  }
+  return 100 * 256;
+}
+} // namespace
+
 Battery::Battery(int pin) : _pin(pin) {}
 
 void Battery::begin() {
-  analogReadResolution(12);
+  // The voltage divider has a high impedance so sample slowly.
+  adc.adc0->setResolution(12);
+  adc.adc0->setAveraging(32);
+  adc.adc0->setConversionSpeed(ADC_CONVERSION_SPEED::LOW_SPEED);
+  adc.adc0->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_LOW_SPEED);
+  reset();
+}
+
+void Battery::update() {
+  if (_converting) {
+    if (!adc.adc0->isComplete()) return;
+    addSample(toMillivolts(adc.adc0->readSingle()));
+  }
+  _converting = adc.adc0->startSingleRead(_pin);
+}
+
+void Battery::reset() {
+  millivolt_t sample = toMillivolts(adc.adc0->analogRead(_pin));
+  std::fill(std::begin(_window), std::end(_window), sample);
+  _filtered = uint32_t(sample) << FILTER_SHIFT;
+  _converting = false;
 }
 
-millivolt_t Battery::read() {
-  uint32_t t = millis() >> 7; // don't sample any faster than about 7 Hz to avoid draining the capacitor
-  if (t != _sampleTime) {
-    constexpr uint32_t vref = 3310; // 3.310 V
-    _sampleTime = t;
-    _sample = millivolt_t(analogRead(_pin) * vref / 2047);
+void Battery::addSample(millivolt_t sample) {
+  _window[_windowIndex] = sample;
+  _windowIndex = (_windowIndex + 1) % 3;
+
+  millivolt_t a = _window[0], b = _window[1], c = _window[2];
+  millivolt_t median = std::max(std::min(a, b), std::min(std::max(a, b), c));
+  _filtered += median - int32_t(_filtered >> FILTER_SHIFT);
+}
+
+ChargeEstimator::ChargeEstimator(Battery* battery, GetLoadCallback getLoadCallback,
+    GetChargerStateCallback getChargerStateCallback) :
+    _battery(battery), _getLoadCallback(std::move(getLoadCallback)),
+    _getChargerStateCallback(std::move(getChargerStateCallback)) {}
+
+void ChargeEstimator::update() {
+  time_t time = now();
+  if (_valid && time == _updateTime) return;
+
+  _chargerState = _getChargerStateCallback();
+  uint32_t voltage = _battery->read()
+      + _getLoadCallback() * INTERNAL_RESISTANCE / 1000000;
+  uint32_t target;
+  switch (_chargerState) {
+    default:
+    case ChargerState::DISCHARGING:
+      target = chargeFromVoltage(voltage);
+      break;
+    case ChargerState::CHARGING:
+      target = chargeFromVoltage(voltage > CHARGING_VOLTAGE_RISE ? voltage - CHARGING_VOLTAGE_RISE : 0);
+      break;
+    case ChargerState::POWERED:
+      target = 100 * 256;
+      break;
+  }
+
+  target <<= CHARGE_EXTRA_BITS;
+  if (!_valid) {
+    _charge = target;
+    _valid = true;
+  } else {
+    // Decay exponentially towards the target so that frequent updates add up
+    // to the same result as one long one.
+    time_t elapsed = time - _updateTime;
+    uint32_t charge = elapsed < 0 ? target : uint32_t(int64_t(target)
+        + (int64_t(_charge) - int64_t(target)) * int64_t(chargeDecay(elapsed)) / (1LL << 30));
+    // The charge can't go down while charging.
+    _charge = _chargerState == ChargerState::CHARGING ? std::max(charge, _charge) : charge;
   }
-  return _sample;
+  _updateTime = time;
 }
 
-BatteryHistory::BatteryHistory(Battery* battery, Storage storage) :
-    _battery(battery), _storage(storage) {}
+uint32_t ChargeEstimator::hoursRemaining(microamp_t load) const {
+  if (load == 0) return UINT32_MAX;
+  return uint32_t(uint64_t(CAPACITY) * _charge / (100 << CHARGE_FRACTION_BITS) / load);
+}
+
+BatteryHistory::BatteryHistory(Battery* battery, ChargeEstimator* chargeEstimator, Storage storage,
+    SummaryStorage bihourlyStorage, SummaryStorage dailyStorage, ChargeStorage chargeStorage) :
+    _battery(battery), _chargeEstimator(chargeEstimator), _storage(storage),
+    _summaryStorage{bihourlyStorage, dailyStorage}, _chargeStorage(chargeStorage) {}
+
+time_t BatteryHistory::interval(Tier tier) {
+  switch (tier) {
+    default:
+    case Tier::SAMPLES:
+      return INTERVAL;
+    case Tier::BIHOURLY:
+      return 60 * 60 * 2;
+    case Tier::DAILY:
+      return 60 * 60 * 24;
+  }
+}
+
+unsigned BatteryHistory::length(Tier tier) {
+  return tier == Tier::SAMPLES ? LENGTH : SUMMARY_LENGTH;
+}
 
 uint32_t BatteryHistory::currentPeriod() {
   return (now() / INTERVAL) % LENGTH;
 }
 
+uint32_t BatteryHistory::currentPeriod(Tier tier) {
+  return (now() / interval(tier)) % length(tier);
+}
+
+uint32_t BatteryHistory::samplesPerSummary(unsigned summaryTier) {
+  return interval(Tier(summaryTier + 1)) / INTERVAL;
+}
+
 void BatteryHistory::begin() {
   uint32_t index = now() / INTERVAL;
-  uint32_t next = *LAST_SAMPLE_INDEX + 1;
-  uint32_t cleared = 0;
-  while (next < index && cleared < LENGTH) {
-    _storage.setAt(next % LENGTH, 0);
-    next++;
-    cleared++;
+  uint32_t last = *LAST_SAMPLE_INDEX;
+  clearSkippedSamples(index);
+
+  // Rebuild the summaries of the current periods from the samples.
+  for (unsigned i = 0; i < SUMMARY_TIERS; i++) {
+    const uint32_t ratio = samplesPerSummary(i);
+    const uint32_t period = index / ratio;
+    _rollups[i].period = last / ratio;
+    advanceRollup(i, period);
+
+    uint32_t first = std::max(period * ratio, index >= LENGTH ? index - LENGTH + 1 : 0);
+    for (uint32_t j = first; j < index; j++) {
+      _rollups[i].add(readLevel(j % LENGTH));
+    }
   }
 
   writeSample(index);
 }
 
 void BatteryHistory::update() {
-  uint32_t index = now() / INTERVAL;
-  if (*LAST_SAMPLE_INDEX == index) return;
+  _chargeEstimator->update();
 
-  writeSample(index);
+  time_t time = now();
+  uint32_t index = time / INTERVAL;
+  if (*LAST_SAMPLE_INDEX != index) {
+    clearSkippedSamples(index);
+    writeSample(index);
+  }
+  updateChargeLog(time, _chargeEstimator->chargerState());
+}
+
+void BatteryHistory::updateChargeLog(time_t time, ChargerState state) {
+  // Start over if the clock jumped, such as when it is set.
+  if (_chargeLogTime == 0 || time < _chargeLogTime
+      || uint32_t(time - _chargeLogTime) >= LENGTH * INTERVAL) {
+    _chargeLogTime = time;
+    _chargeLogState = state;
+    return;
+  }
+
+  // Attribute the time since the last update to the state during that time,
+  // splitting it between periods.
+  while (_chargeLogTime < time) {
+    const uint32_t period = _chargeLogTime / INTERVAL;
+    const time_t end = std::min(time, time_t(period + 1) * INTERVAL);
+    if (period + 1 != *CHARGE_LOG_PERIOD) {
+      // Write what there was of the previous period if it wasn't finished,
+      // such as when restarted after being switched off.
+      commitChargeLog(period);
+      *CHARGE_LOG_PERIOD = period + 1;
+      *CHARGE_LOG_SECONDS = 0;
+    }
+
+    const uint32_t seconds = end - _chargeLogTime;
+    uint32_t total = *CHARGE_LOG_SECONDS;
+    if (_chargeLogState != ChargerState::DISCHARGING) total += seconds << CHARGE_LOG_POWERED_SHIFT;
+    if (_chargeLogState == ChargerState::CHARGING) total += seconds;
+    *CHARGE_LOG_SECONDS = total;
+    _chargeLogTime = end;
+
+    if (end == time_t(period + 1) * INTERVAL) {
+      commitChargeLog(period);
+    }
+  }
+  _chargeLogState = state;
+}
+
+void BatteryHistory::commitChargeLog(uint32_t currentPeriod) {
+  // Skip it if the ring has moved on since, such as when the clock jumped.
+  const uint32_t pending = *CHARGE_LOG_PERIOD;
+  if (!pending || pending - 1 > currentPeriod || currentPeriod - (pending - 1) >= LENGTH) return;
+  _chargeStorage.setAt((pending - 1) % LENGTH, packChargeMinutes(*CHARGE_LOG_SECONDS));
+}
+
+uint8_t BatteryHistory::readChargeLog(uint32_t index) const {
+  if (index + 1 == *CHARGE_LOG_PERIOD) return packChargeMinutes(*CHARGE_LOG_SECONDS);
+  return _chargeStorage.getAt(index % LENGTH);
 }
 
-void BatteryHistory::writeSample(uint32_t index) {  
+BatteryHistory::ChargeMinutes BatteryHistory::getChargeMinutes(Tier tier, uint32_t age) const {
+  return getChargeMinutes(tier, age, now());
+}
+
+BatteryHistory::ChargeMinutes BatteryHistory::getChargeMinutes(
+    Tier tier, uint32_t age, time_t time) const {
+  const uint32_t samplesPerPeriod = interval(tier) / INTERVAL;
+  const uint32_t newest = time / INTERVAL;
+  const uint32_t first = (time / interval(tier) - age) * samplesPerPeriod;
+  const uint32_t oldest = newest >= LENGTH ? newest - LENGTH + 1 : 0;
+
+  ChargeMinutes minutes{};
+  for (uint32_t i = std::max(first, oldest); i < first + samplesPerPeriod && i <= newest; i++) {
+    const uint8_t byte = readChargeLog(i);
+    minutes.charging += byte & 0xf;
+    minutes.powered += byte >> 4;
+  }
+  return minutes;
+}
+
+void BatteryHistory::advanceRollup(unsigned summaryTier, uint32_t period) {
+  Rollup& rollup = _rollups[summaryTier];
+  if (rollup.period == period) return;
+
+  // Clear the summaries for periods that were skipped.
+  uint32_t next = rollup.period + 1;
+  uint32_t cleared = 0;
+  while (next < period && cleared < SUMMARY_LENGTH) {
+    _summaryStorage[summaryTier].setAt(next % SUMMARY_LENGTH, Summary{});
+    next++;
+    cleared++;
+  }
+
+  rollup = Rollup{};
+  rollup.period = period;
+}
+
+void BatteryHistory::clearSkippedSamples(uint32_t index) {
+  // Mark the samples since the last one as missing, such as when the clock
+  // jumps forward, so that later samples aren't decoded from stale levels.
+  uint32_t next = *LAST_SAMPLE_INDEX + 1;
+  uint32_t cleared = 0;
+  while (next < index && cleared < LENGTH) {
+    writeLevel(next, 0);
+    next++;
+    cleared++;
+  }
+}
+
+void BatteryHistory::writeSample(uint32_t index) {
   millivolt_t voltage = _battery->read();
 
-  uint8_t level = voltage <= 3000 ? 0 : voltage >= 5550 ? 255 : uint8_t((voltage - 3000) / 10);
-  _storage.setAt(index % LENGTH, level);
+  // Clear the charge log for the new period and any that were skipped.
+  // Leave it alone when restarted during the same period so it can pick up
+  // where it left off.
+  const uint32_t last = *LAST_SAMPLE_INDEX;
+  if (last < index) {
+    for (uint32_t i = index - last < LENGTH ? last + 1 : index - LENGTH + 1; i <= index; i++) {
+      _chargeStorage.setAt(i % LENGTH, 0);
+    }
+  } else if (last > index) {
+    _chargeStorage.setAt(index % LENGTH, 0); // the clock went back
+  }
+
+  uint8_t level = toLevel(voltage);
+  writeLevel(index, level);
+
+  for (unsigned i = 0; i < SUMMARY_TIERS; i++) {
+    const uint32_t period = index / samplesPerSummary(i);
+    advanceRollup(i, period);
+    _rollups[i].add(level);
+    _summaryStorage[i].setAt(period % SUMMARY_LENGTH, _rollups[i].summary());
+  }
 
   *LAST_SAMPLE_INDEX = index;
 
@@ -71,8 +374,136 @@ void BatteryHistory::writeSample(uint32_t index) {
 #endif
 }
 
+void BatteryHistory::convertUncompressedSamples() {
+  constexpr unsigned OLD_LENGTH = STORAGE_SIZE;
+  uint8_t levels[OLD_LENGTH];
+  for (unsigned i = 0; i < OLD_LENGTH; i++) {
+    levels[i] = _storage.getAt(i);
+  }
+
+  for (uint32_t block = 0; block < STORAGE_SIZE / BLOCK_SIZE; block++) {
+    clearBlock(block);
+  }
+
+  // Re-encode the samples up to the last one written in chronological order.
+  const uint32_t last = *LAST_SAMPLE_INDEX;
+  const uint32_t first = last >= OLD_LENGTH ? last - OLD_LENGTH + 1 : 0;
+  for (uint32_t index = first; index <= last; index++) {
+    writeLevel(index, levels[index % OLD_LENGTH]);
+  }
+}
+
 millivolt_t BatteryHistory::getAt(uint32_t period) const {
-  return _storage.getAt(period) * 10U + 3000;
+  return readLevel(period) * 10U + 3000;
+}
+
+int32_t BatteryHistory::chargeTrend() const {
+  constexpr uint32_t TREND_PERIODS = 8;
+  const uint32_t newestPeriod = currentPeriod();
+  const uint8_t newest = readLevel(newestPeriod);
+  const uint8_t oldest = readLevel((newestPeriod + LENGTH - TREND_PERIODS) % LENGTH);
+  if (!newest || !oldest) return 0;
+
+  int32_t change = int32_t(chargeFromVoltage(newest * 10U + 3000))
+      - int32_t(chargeFromVoltage(oldest * 10U + 3000));
+  return change * 100 / 256 * int32_t(SECS_PER_HOUR) / int32_t(TREND_PERIODS * INTERVAL);
+}
+
+uint8_t BatteryHistory::readLevel(uint32_t period) const {
+  const uint32_t base = period / SAMPLES_PER_BLOCK * BLOCK_SIZE;
+  const uint32_t offset = period % SAMPLES_PER_BLOCK;
+
+  int32_t level = _storage.getAt(base);
+  uint8_t nibble = MISSING;
+  for (uint32_t i = 0; i <= offset; i++) {
+    const uint8_t byte = _storage.getAt(base + 1 + i / 2);
+    nibble = i & 1 ? byte >> 4 : byte & 0xf;
+    if (nibble != MISSING) {
+      level += nibble & 0x8 ? int32_t(nibble) - 16 : nibble;
+    }
+  }
+  return nibble == MISSING ? 0 : uint8_t(level);
+}
+
+void BatteryHistory::writeLevel(uint32_t index, uint8_t level) {
+  const uint32_t period = index % LENGTH;
+  const uint32_t block = period / SAMPLES_PER_BLOCK;
+  const uint32_t base = block * BLOCK_SIZE;
+  const uint32_t offset = period % SAMPLES_PER_BLOCK;
+  if (offset == 0) {
+    clearBlock(block);
+  }
+  const uint32_t addr = base + 1 + offset / 2;
+  const uint8_t byte = _storage.getAt(addr);
+  if (!level) {
+    _storage.setAt(addr, offset & 1 ? (byte & 0x0f) | (MISSING << 4) : (byte & 0xf0) | MISSING);
+    return;
+  }
+
+  // Decode the block up to the most recent sample to take the delta from.
+  // If there isn't one, the keyframe can be moved to this sample because
+  // none of the earlier samples depend on it.
+  int32_t previous = _storage.getAt(base);
+  bool found = false;
+  for (uint32_t i = 0; i < offset; i++) {
+    const uint8_t byte = _storage.getAt(base + 1 + i / 2);
+    const uint8_t nibble = i & 1 ? byte >> 4 : byte & 0xf;
+    if (nibble != MISSING) {
+      previous += nibble & 0x8 ? int32_t(nibble) - 16 : nibble;
+      found = true;
+    }
+  }
+
+  int32_t delta = 0;
+  if (!found) {
+    _storage.setAt(base, level);
+  } else {
+    // Large jumps are spread over the following samples.
+    delta = std::min(std::max(int32_t(level) - previous, -MAX_DELTA), MAX_DELTA);
+  }
+
+  const uint8_t nibble = uint8_t(delta) & 0xf;
+  _storage.setAt(addr, offset & 1 ? (byte & 0x0f) | (nibble << 4) : (byte & 0xf0) | nibble);
+}
+
+void BatteryHistory::clearBlock(uint32_t block) {
+  const uint32_t base = block * BLOCK_SIZE;
+  _storage.setAt(base, 0);
+  for (uint32_t i = 1; i < BLOCK_SIZE; i++) {
+    _storage.setAt(base + i, MISSING | (MISSING << 4));
+  }
+}
+
+BatteryHistory::Reading BatteryHistory::getAt(Tier tier, uint32_t period) const {
+  if (tier == Tier::SAMPLES) {
+    const millivolt_t voltage = getAt(period);
+    return Reading{voltage, voltage, voltage};
+  }
+
+  const Summary summary = _summaryStorage[unsigned(tier) - 1].getAt(period);
+  return Reading{
+    millivolt_t(summary.min * 10U + 3000),
+    millivolt_t(summary.avg * 10U + 3000),
+    millivolt_t(summary.max * 10U + 3000)
+  };
+}
+
+bool BatteryHistory::isMissing(const Reading& reading) {
+  return reading.avg <= 3000;
+}
+
+void BatteryHistory::Rollup::add(uint8_t level) {
+  if (!level) return; // no sample
+
+  sum += level;
+  min = count ? std::min(min, level) : level;
+  max = count ? std::max(max, level) : level;
+  count++;
+}
+
+BatteryHistory::Summary BatteryHistory::Rollup::summary() const {
+  if (!count) return Summary{};
+  return Summary{min, uint8_t((sum + count / 2) / count), max};
 }
 
 LowBatteryDetector::LowBatteryDetector(Battery* battery,
@@ -6,51 +6,229 @@
 
 #include <Arduino.h>
 
+#include "energy.h"
 #include "settings.h"
 
 using millivolt_t = uint16_t;
 
 // Reads the battery voltage from an analog pin with a voltage divider.
 //
+// Conversions run in the background using the ADC's hardware averaging.
+// The samples are filtered with a median of three to reject spikes, such as
+// when the lights change, followed by an exponential moving average.
+//
 // Wiring: 100 K resistor to Vbat
 //         100 K resistor to GND
 //         100 nF capacitor to GND
 class Battery {
 public:
+  // Don't sample any faster than this to avoid draining the capacitor.
+  constexpr static uint32_t SAMPLE_INTERVAL = 150; // milliseconds
+
   explicit Battery(int pin);
 
   void begin();
-  millivolt_t read();
+
+  // Collects the result of the previous conversion and starts the next one.
+  // Call every SAMPLE_INTERVAL.  Does not block.
+  void update();
+
+  // Restarts filtering from a fresh reading, such as after sleeping.
+  // Blocks briefly while converting.
+  void reset();
+
+  // Gets the filtered battery voltage.  Does not block.
+  inline millivolt_t read() const { return millivolt_t(_filtered >> FILTER_SHIFT); }
 
 private:
+  constexpr static uint32_t FILTER_SHIFT = 3; // weight of new samples is 1/8
+
+  void addSample(millivolt_t sample);
+
   const int _pin;
 
-  uint32_t _sampleTime = 0xffffffff;
-  millivolt_t _sample = 0;
+  bool _converting = false;
+  millivolt_t _window[3] = {};
+  uint8_t _windowIndex = 0;
+  uint32_t _filtered = 0; // millivolts with FILTER_SHIFT fractional bits
+};
+
+// Whether the battery is being charged.
+enum class ChargerState : uint8_t {
+  DISCHARGING, // running from the battery
+  CHARGING, // external power is charging the battery
+  POWERED // external power is present and the battery is full
+};
+
+// Estimates the battery's state of charge.
+//
+// The voltage is measured under load so it's compensated for the drop across
+// the battery's internal resistance then looked up on a typical LiPo discharge
+// curve.  The estimate is smoothed over several minutes since the voltage
+// recovers slowly after the load changes.
+class ChargeEstimator {
+public:
+  using GetLoadCallback = microamp_t (*)();
+  using GetChargerStateCallback = ChargerState (*)();
+
+  constexpr static microamp_hour_t CAPACITY = 2000000; // 2000 mAh
+  constexpr static uint32_t INTERNAL_RESISTANCE = 150; // milliohms
+
+  ChargeEstimator(Battery* battery, GetLoadCallback getLoadCallback,
+      GetChargerStateCallback getChargerStateCallback);
+
+  // Updates the estimate.  Cheap enough to call on every wake.
+  void update();
+
+  // Gets the estimated state of charge from 0 to 100 percent.
+  inline uint8_t percent() const {
+    return uint8_t((_charge + (1 << (CHARGE_FRACTION_BITS - 1))) >> CHARGE_FRACTION_BITS);
+  }
+
+  // Gets the charger state as of the last update.
+  inline ChargerState chargerState() const { return _chargerState; }
+
+  // Estimates how many hours the remaining charge will last at the given load.
+  uint32_t hoursRemaining(microamp_t load) const;
+
+private:
+  // The charge curve has 8 fractional bits.  Smoothing keeps 8 more so that
+  // small steps every second aren't lost to rounding.
+  constexpr static uint32_t CHARGE_EXTRA_BITS = 8;
+  constexpr static uint32_t CHARGE_FRACTION_BITS = 8 + CHARGE_EXTRA_BITS;
+
+  Battery* const _battery;
+  GetLoadCallback const _getLoadCallback;
+  GetChargerStateCallback const _getChargerStateCallback;
+
+  uint32_t _charge = 0; // percent with CHARGE_FRACTION_BITS fractional bits
+  time_t _updateTime = 0;
+  bool _valid = false;
+  ChargerState _chargerState = ChargerState::DISCHARGING;
 };
 
 // Maintains a record of recent battery voltage levels.
+//
+// Samples are rolled up into the minimum, average, and maximum levels
+// for every 2 hours and for every day to keep track of longer term trends
+// in a bounded amount of storage.
+//
+// Samples are stored in blocks of 16 bytes that begin with a keyframe level
+// followed by 30 nibbles of deltas from the previous sample so that each
+// block can be decoded on its own.  Starting a new block discards the oldest
+// samples in the ring.
+//
+// Alongside each sample, it also records how many minutes of the period were
+// spent charging and on external power, one nibble each.  These are written
+// once the period is over to limit wear on the EEPROM.
 class BatteryHistory {
 public:
   constexpr static time_t INTERVAL = 60 * 15; // sample every 15 minutes
-  constexpr static unsigned LENGTH = 256;
-
-  using Storage = SettingArray<uint8_t, LENGTH>;
-
-  BatteryHistory(Battery* battery, Storage storage);
+  constexpr static unsigned STORAGE_SIZE = 256;
+  constexpr static unsigned BLOCK_SIZE = 16;
+  constexpr static unsigned SAMPLES_PER_BLOCK = (BLOCK_SIZE - 1) * 2;
+  constexpr static unsigned LENGTH = STORAGE_SIZE / BLOCK_SIZE * SAMPLES_PER_BLOCK;
+  constexpr static unsigned SUMMARY_LENGTH = 120;
+
+  enum class Tier : uint8_t {
+    SAMPLES, // every 15 minutes, LENGTH periods
+    BIHOURLY, // every 2 hours, SUMMARY_LENGTH periods
+    DAILY // every day, SUMMARY_LENGTH periods
+  };
+
+  // Stored summary of the levels within a period.
+  struct Summary {
+    uint8_t min, avg, max;
+  };
+
+  // Voltages within a period.  All the same for samples.
+  struct Reading {
+    millivolt_t min, avg, max;
+  };
+
+  // Minutes spent charging and on external power within a period.
+  struct ChargeMinutes {
+    uint16_t charging, powered;
+  };
+
+  using Storage = SettingArray<uint8_t, STORAGE_SIZE>;
+  using SummaryStorage = SettingArray<Summary, SUMMARY_LENGTH>;
+  using ChargeStorage = SettingArray<uint8_t, LENGTH>;
+
+  BatteryHistory(Battery* battery, ChargeEstimator* chargeEstimator, Storage storage,
+      SummaryStorage bihourlyStorage, SummaryStorage dailyStorage, ChargeStorage chargeStorage);
+
+  static time_t interval(Tier tier);
+  static unsigned length(Tier tier);
 
   static uint32_t currentPeriod();
+  static uint32_t currentPeriod(Tier tier);
 
   void begin();
   void update();
 
+  // Converts samples stored one byte per sample in the same storage by
+  // an earlier schema to the block encoding.
+  void convertUncompressedSamples();
+
   millivolt_t getAt(uint32_t period) const;
+  Reading getAt(Tier tier, uint32_t period) const;
+
+  // Returns true if no samples were recorded during the reading's period.
+  // Missing levels are stored as zero so they read as the lowest voltage.
+  static bool isMissing(const Reading& reading);
+
+  // Gets the minutes spent charging and on external power during the period of
+  // a tier that is the given number of periods before the current one.
+  // Only counts as far back as the samples go.
+  ChargeMinutes getChargeMinutes(Tier tier, uint32_t age) const;
+
+  // Like above but counts back from the period that holds the given time
+  // rather than now, so that a series of calls can share one snapshot.
+  ChargeMinutes getChargeMinutes(Tier tier, uint32_t age, time_t time) const;
+
+  // Gets how fast the state of charge changed over the last couple of hours
+  // in hundredths of a percent per hour.  Negative while discharging.
+  // Returns 0 if there aren't enough samples.
+  int32_t chargeTrend() const;
 
 private:
+  constexpr static unsigned SUMMARY_TIERS = 2;
+
+  // Accumulates the samples within the current period of a summary tier.
+  struct Rollup {
+    uint32_t period = 0;
+    uint16_t sum = 0;
+    uint8_t count = 0;
+    uint8_t min = 0;
+    uint8_t max = 0;
+
+    void add(uint8_t level);
+    Summary summary() const;
+  };
+
   Battery* const _battery;
+  ChargeEstimator* const _chargeEstimator;
   Storage const _storage;
+  SummaryStorage const _summaryStorage[SUMMARY_TIERS];
+  ChargeStorage const _chargeStorage;
+  Rollup _rollups[SUMMARY_TIERS];
+
+  time_t _chargeLogTime = 0;
+  ChargerState _chargeLogState = ChargerState::DISCHARGING;
+
+  static uint32_t samplesPerSummary(unsigned summaryTier);
+
+  uint8_t readLevel(uint32_t period) const;
+  void writeLevel(uint32_t index, uint8_t level);
+  void clearBlock(uint32_t block);
 
+  void advanceRollup(unsigned summaryTier, uint32_t period);
+  void clearSkippedSamples(uint32_t index);
   void writeSample(uint32_t index);
+  void updateChargeLog(time_t time, ChargerState state);
+  void commitChargeLog(uint32_t currentPeriod);
+  uint8_t readChargeLog(uint32_t index) const;
 };
 
 class LowBatteryDetector {
@@ -0,0 +1,116 @@
+#include "console.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace {
+// Reflected CRC-32 (IEEE 802.3), the same as zlib and most tools use.
+constexpr uint32_t CRC32_POLYNOMIAL = 0xedb88320;
+
+uint32_t crc32Update(uint32_t crc, uint8_t b) {
+  crc ^= b;
+  for (int i = 0; i < 8; i++) {
+    crc = (crc >> 1) ^ (CRC32_POLYNOMIAL & (0 - (crc & 1)));
+  }
+  return crc;
+}
+} // namespace
+
+size_t Console::CrcPrint::write(uint8_t b) {
+  crc = crc32Update(crc, b);
+  return target.write(b);
+}
+
+size_t Console::CrcPrint::write(const uint8_t* buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    crc = crc32Update(crc, buffer[i]);
+  }
+  return target.write(buffer, size);
+}
+
+Console::Console(Stream& stream, const Command* commands, size_t commandCount) :
+    _stream(stream), _commands(commands), _commandCount(commandCount), _out(stream) {}
+
+void Console::update() {
+  if (_producer) {
+    for (unsigned i = 0; i < MAX_CHUNKS_PER_UPDATE; i++) {
+      if (_stream.availableForWrite() < CHUNK_SPACE) return;
+      if (!_producer(*this, _chunkIndex++)) {
+        _producer = nullptr;
+        break;
+      }
+    }
+    if (_producer) return;
+  }
+
+  while (_stream.available() > 0) {
+    const char c = char(_stream.read());
+    if (c == '\r' || c == '\n') {
+      if (_overflow) {
+        _stream.println("error: line too long");
+      } else if (_lineLength) {
+        _line[_lineLength] = '\0';
+        runLine();
+      }
+      _lineLength = 0;
+      _overflow = false;
+
+      // Leave the rest of the input until the output has been streamed.
+      if (_producer) return;
+    } else if (_lineLength < MAX_LINE_LENGTH) {
+      _line[_lineLength++] = c;
+    } else {
+      _overflow = true;
+    }
+  }
+}
+
+void Console::reset() {
+  _producer = nullptr;
+  _lineLength = 0;
+  _overflow = false;
+}
+
+void Console::beginStream(Producer producer) {
+  _producer = producer;
+  _chunkIndex = 0;
+  _out.crc = 0xffffffff;
+}
+
+void Console::printHelp() {
+  for (size_t i = 0; i < _commandCount; i++) {
+    _stream.print(_commands[i].name);
+    if (*_commands[i].usage) {
+      _stream.print(' ');
+      _stream.print(_commands[i].usage);
+    }
+    _stream.println();
+  }
+}
+
+char* Console::nextWord(char** args) {
+  char* word = *args;
+  while (*word && isspace(*word)) word++;
+  char* end = word;
+  while (*end && !isspace(*end)) end++;
+  if (*end) *end++ = '\0';
+  *args = end;
+  return word;
+}
+
+void Console::runLine() {
+  char* args = _line;
+  const char* name = nextWord(&args);
+  if (!*name) return;
+  while (*args && isspace(*args)) args++;
+
+  for (size_t i = 0; i < _commandCount; i++) {
+    if (strcmp(name, _commands[i].name) == 0) {
+      _commands[i].handler(*this, args);
+      return;
+    }
+  }
+  _stream.print("error: unknown command '");
+  _stream.print(name);
+  _stream.println("', try 'help'");
+}
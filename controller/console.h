@@ -0,0 +1,94 @@
+/*
+ * Line-oriented command console over a serial stream.
+ *
+ * Reads a line at a time without blocking and runs the matching command.
+ * Long output is produced one small chunk at a time while the stream has
+ * room for it so that exporting data never holds up the rest of the loop.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Print.h>
+
+class Console {
+public:
+  // Runs a command.  The arguments are the rest of the line after the
+  // command name with leading spaces removed.
+  using Handler = void (*)(Console& console, char* args);
+
+  // Writes the chunk of streamed output with the given index.
+  // Returns false once there is no more output.
+  using Producer = bool (*)(Console& console, uint32_t index);
+
+  struct Command {
+    const char* name;
+    const char* usage;
+    Handler handler;
+  };
+
+  constexpr static size_t MAX_LINE_LENGTH = 63;
+
+  // Stream while there is at least this much room in the output buffer.
+  constexpr static int CHUNK_SPACE = 48;
+  constexpr static unsigned MAX_CHUNKS_PER_UPDATE = 4;
+
+  Console(Stream& stream, const Command* commands, size_t commandCount);
+  ~Console() = default;
+
+  // Reads input and runs commands or continues streaming output.
+  void update();
+
+  // Stops streaming and discards partial input, such as when the host disconnects.
+  void reset();
+
+  // Returns true while streaming output.
+  inline bool isBusy() const { return _producer != nullptr; }
+
+  // Starts streaming output from the producer.  Input is ignored until it finishes.
+  void beginStream(Producer producer);
+
+  // Output that keeps a running CRC-32 of the bytes written since the
+  // stream began so it can be appended to exported data.
+  inline Print& out() { return _out; }
+  inline uint32_t crc() const { return ~_out.crc; }
+
+  // Prints the usage of every command.
+  void printHelp();
+
+  // Splits the next space-delimited word off the arguments.
+  // Returns an empty string if there are no more words.
+  static char* nextWord(char** args);
+
+private:
+  Console(const Console&) = delete;
+  Console(Console&&) = delete;
+  Console& operator=(const Console&) = delete;
+  Console& operator=(Console&&) = delete;
+
+  class CrcPrint : public Print {
+  public:
+    explicit CrcPrint(Print& target) : target(target) {}
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int availableForWrite() override { return target.availableForWrite(); }
+
+    Print& target;
+    uint32_t crc = 0xffffffff;
+  };
+
+  void runLine();
+
+  Stream& _stream;
+  const Command* const _commands;
+  const size_t _commandCount;
+  CrcPrint _out;
+
+  char _line[MAX_LINE_LENGTH + 1];
+  size_t _lineLength = 0;
+  bool _overflow = false;
+
+  Producer _producer = nullptr;
+  uint32_t _chunkIndex = 0;
+};
@@ -1,6 +1,7 @@
 /*
  * Required libraries:
  *
+ * - ADC
  * - Snooze
  *
  * Wiring:
@@ -29,8 +30,13 @@
 #include <TimeLib.h>
 
 #include "battery.h"
+#include "console.h"
+#include "energy.h"
+#include "lights.h"
 #include "panel.h"
+#include "scheduler.h"
 #include "settings.h"
+#include "stats.h"
 #include "ui.h"
 #include "utils.h"
 
@@ -108,7 +114,7 @@ LightState mergeLightState(LightState a, LightState b) {
 }
 
 namespace {
-const uint32_t SETTINGS_SCHEMA_VERSION = 2;
+const uint32_t SETTINGS_SCHEMA_VERSION = 6;
 Setting<uint8_t> activityTimeoutSeconds(0);
 Setting<uint8_t> dawnHour(1);
 Setting<uint8_t> duskHour(2);
@@ -116,6 +122,7 @@ Setting<uint8_t> nightHour(3);
 Setting<OnOff> lightsOn(7);
 Setting<LowBattery> lowBatteryCutoff(8);
 Setting<OnOff> sleepOn(9);
+Setting<uint8_t> lightsFadeTenths(10);
 Setting<tint_t> museumLightTint(100);
 Setting<tone_t> museumLightTone(101);
 Setting<brightness_t> museumLightBrightnessDaytime(102);
@@ -127,11 +134,19 @@ Setting<brightness_t> libraryLightBrightnessDaytime(202);
 Setting<brightness_t> libraryLightBrightnessEvening(203);
 Setting<brightness_t> libraryLightBrightnessNighttime(204);
 Setting<brightness_t> libraryLightBrightnessWhenOpen(205);
+BatteryHistory::ChargeStorage batteryHistoryChargeStorage(520);
 BatteryHistory::Storage batteryHistoryStorage(1000);
+BatteryHistory::SummaryStorage batteryHistoryBihourlyStorage(1256);
+BatteryHistory::SummaryStorage batteryHistoryDailyStorage(1616);
 Setting<uint8_t> testSetting1(2000);
 Setting<int8_t> testSetting2(2001);
 Setting<StrandTestPattern> strandTestPattern(2002);
 
+// Ranges of the numeric settings, shared by the menus and the serial console.
+constexpr uint8_t LIGHTS_FADE_TENTHS_MAX = 50;
+constexpr uint8_t HOUR_MAX = 23;
+constexpr uint8_t ACTIVITY_TIMEOUT_SECONDS_MAX = 240;
+
 void resetSettings() {
   activityTimeoutSeconds.set(30);
   dawnHour.set(7);
@@ -140,6 +155,7 @@ void resetSettings() {
   lightsOn.set(OnOff::ON);
   lowBatteryCutoff.set(LowBattery::V3_4);
   sleepOn.set(OnOff::ON);
+  lightsFadeTenths.set(10);
   museumLightTint.set(TINT_WHITE);
   museumLightTone.set(TONE_DEFAULT);
   museumLightBrightnessDaytime.set(BRIGHTNESS_OFF);
@@ -161,14 +177,36 @@ Settings settings;
 Panel panel;
 Binding binding(&panel);
 Stage stage(&binding,
-  [] { return activityTimeoutSeconds.get() * 1000UL; });
+  []() -> millis_t { return activityTimeoutSeconds.get() * 1000UL; });
 
 constexpr int VBAT_PIN = A6;
 constexpr int CHG_PIN = 3;
 constexpr int PGOOD_PIN = 4;
 
+EnergyMeter energyMeter;
+
+ChargerState readChargerState() {
+  if (!digitalRead(CHG_PIN)) return ChargerState::CHARGING;
+  if (!digitalRead(PGOOD_PIN)) return ChargerState::POWERED;
+  return ChargerState::DISCHARGING;
+}
+
+// Estimates the current drawn while the lights stay as they are and the
+// controller is otherwise idle.
+microamp_t lightingLoad() {
+  return MCU_ASLEEP_CURRENT + estimatePanelCurrent(false, RGB{}, RGB{})
+      + energyMeter.getLoad(EnergyMeter::Consumer::STRIP);
+}
+
 Battery battery(VBAT_PIN);
-BatteryHistory batteryHistory(&battery, batteryHistoryStorage);
+ChargeEstimator chargeEstimator(&battery,
+    []() -> microamp_t {
+      return MCU_AWAKE_CURRENT + energyMeter.getLoad(EnergyMeter::Consumer::PANEL)
+          + energyMeter.getLoad(EnergyMeter::Consumer::STRIP);
+    },
+    readChargerState);
+BatteryHistory batteryHistory(&battery, &chargeEstimator, batteryHistoryStorage,
+    batteryHistoryBihourlyStorage, batteryHistoryDailyStorage, batteryHistoryChargeStorage);
 LowBatteryDetector lowBatteryDetector(&battery, []() -> millivolt_t {
   switch (lowBatteryCutoff.get()) {
     default:
@@ -185,6 +223,40 @@ LowBatteryDetector lowBatteryDetector(&battery, []() -> millivolt_t {
   }
 });
 
+bool migrateSettings(uint8_t fromVersion) {
+  switch (fromVersion) {
+    case 2: // added battery history summaries
+      batteryHistoryBihourlyStorage.clear();
+      batteryHistoryDailyStorage.clear();
+      return true;
+    case 3: // compressed battery history samples
+      batteryHistory.convertUncompressedSamples();
+      return true;
+    case 4: // added light fade time
+      lightsFadeTenths.set(10);
+      return true;
+    case 5: // added battery charge log
+      batteryHistoryChargeStorage.clear();
+      return true;
+    default:
+      return false;
+  }
+}
+
+Scheduler scheduler;
+
+Histogram loopMicros("Loop us");
+Counter awakeMillis("Awake ms");
+Counter asleepSeconds("Asleep s");
+Counter sleepCount("Sleeps");
+Counter wakeByAlarm("Wake: alarm");
+Counter wakeByDoor("Wake: door");
+Counter wakeByPanel("Wake: panel");
+Counter wakeByCharger("Wake: charger");
+Counter wakeByOther("Wake: other");
+Histogram stripScalePercent("Strip scale %");
+Histogram nightBudgetMilliamps("Night budget mA");
+
 constexpr int LIGHTS_EN_PIN = 2;
 constexpr int LIGHTS_PIN = 21;
 constexpr unsigned LIGHTS_MUSEUM_FIRST = 0;
@@ -196,6 +268,9 @@ Adafruit_NeoPixel lights(LIGHTS_TOTAL_COUNT, LIGHTS_PIN, NEO_GRBW | NEO_KHZ800);
 RGBW oldLights[LIGHTS_TOTAL_COUNT];
 RGBW newLights[LIGHTS_TOTAL_COUNT];
 bool oldLightsEnabled;
+bool allLightsDirty = true;
+scale8_t lightsCurrentScale = SCALE8_ONE; // applied to limit the current drawn
+LightState lightState = LightState::OFF;
 
 constexpr int MUSEUM_DOOR_PIN = 0;
 constexpr int LIBRARY_DOOR_PIN = 1;
@@ -203,10 +278,52 @@ constexpr int LIBRARY_DOOR_PIN = 1;
 Switch museumDoor(MUSEUM_DOOR_PIN, INPUT_PULLUP);
 Switch libraryDoor(LIBRARY_DOOR_PIN, INPUT_PULLUP);
 
+// Everything that a zone's target color depends on.
+struct LightZoneInputs {
+  tint_t tint;
+  tone_t tone;
+  brightness_t brightness; // BRIGHTNESS_OFF while the lights are switched off
+
+  bool operator==(const LightZoneInputs& other) const {
+    return tint == other.tint && tone == other.tone && brightness == other.brightness;
+  }
+
+  bool operator!=(const LightZoneInputs& other) const { return !(*this == other); }
+};
+
+// A range of lights that share the same settings.
+struct LightZone {
+  size_t first;
+  size_t count;
+  const Setting<tint_t>& tint;
+  const Setting<tone_t>& tone;
+  const Setting<brightness_t>& brightnessDaytime;
+  const Setting<brightness_t>& brightnessEvening;
+  const Setting<brightness_t>& brightnessNighttime;
+  const Setting<brightness_t>* brightnessWhenOpen; // nullptr if the zone has no door
+  Switch* door;
+
+  Fade fade;
+  LightZoneInputs inputs; // inputs that the zone was most recently rendered from
+  RGBW color; // most recently rendered color
+  bool valid; // false if the zone's lights need to be rendered again
+  bool dirty; // true if the zone's lights changed since they were last sent
+};
+
+LightZone lightZones[] = {
+  { LIGHTS_MUSEUM_FIRST, LIGHTS_MUSEUM_COUNT, museumLightTint, museumLightTone,
+    museumLightBrightnessDaytime, museumLightBrightnessEvening, museumLightBrightnessNighttime,
+    nullptr, nullptr, {}, LightZoneInputs{}, RGBW{}, false, false },
+  { LIGHTS_LIBRARY_FIRST, LIGHTS_LIBRARY_COUNT, libraryLightTint, libraryLightTone,
+    libraryLightBrightnessDaytime, libraryLightBrightnessEvening, libraryLightBrightnessNighttime,
+    &libraryLightBrightnessWhenOpen, &libraryDoor, {}, LightZoneInputs{}, RGBW{}, false, false },
+};
+constexpr size_t LIGHT_ZONE_COUNT = sizeof(lightZones) / sizeof(lightZones[0]);
+
 SnoozeDigital snoozeDigital;
 SnoozeUSBSerial snoozeUsbSerial;
-SnoozeTimer snoozeTimer;
-SnoozeBlock snoozeBlock(snoozeUsbSerial, snoozeDigital, snoozeTimer);
+SnoozeAlarm snoozeAlarm;
+SnoozeBlock snoozeBlock(snoozeUsbSerial, snoozeDigital, snoozeAlarm);
 
 enum class TimeOfDay {
   NIGHTTIME,
@@ -230,6 +347,67 @@ TimeOfDay timeOfDay() {
   }
   return TimeOfDay::NIGHTTIME;
 }
+
+// Returns the time of the next change in the time of day after the given time.
+time_t nextTimeOfDayChange(time_t t) {
+  const time_t startOfDay = previousMidnight(t);
+  time_t next = startOfDay + SECS_PER_DAY + dawnHour.get() * SECS_PER_HOUR;
+  for (uint8_t h : { dawnHour.get(), duskHour.get(), nightHour.get() }) {
+    time_t boundary = startOfDay + h * SECS_PER_HOUR;
+    if (boundary <= t) boundary += SECS_PER_DAY;
+    next = std::min(next, boundary);
+  }
+  return next;
+}
+
+// Returns the time of the next dawn after the given time.
+time_t nextDawn(time_t t) {
+  time_t dawn = previousMidnight(t) + dawnHour.get() * SECS_PER_HOUR;
+  return dawn > t ? dawn : dawn + SECS_PER_DAY;
+}
+
+// Keep this much charge in reserve when budgeting for the night.
+constexpr uint8_t NIGHT_BUDGET_RESERVE_PERCENT = 10;
+
+// Current the lights may draw without the battery voltage sagging too far.
+microamp_t batteryStripLimit = STRIP_CURRENT_LIMIT_HIGH;
+
+// Average current the lights may draw so the battery lasts until dawn.
+microamp_t nightStripBudget = STRIP_CURRENT_LIMIT_HIGH;
+
+// Works out how much current the lights can draw for the rest of the night
+// so the battery lasts until dawn instead of reaching the cutoff.
+microamp_t computeNightStripBudget() {
+  if (chargeEstimator.chargerState() != ChargerState::DISCHARGING
+      || timeOfDay() == TimeOfDay::DAYTIME) {
+    return STRIP_CURRENT_LIMIT_HIGH;
+  }
+
+  uint8_t percent = chargeEstimator.percent();
+  if (percent <= NIGHT_BUDGET_RESERVE_PERCENT) return 0;
+  uint64_t charge = uint64_t(ChargeEstimator::CAPACITY) * (percent - NIGHT_BUDGET_RESERVE_PERCENT) / 100;
+
+  // If the battery has been running down faster than the load suggests, such
+  // as when it has lost capacity, assume that will continue.
+  microamp_t load = lightingLoad();
+  int32_t predicted = int32_t(uint64_t(load) * 10000 / ChargeEstimator::CAPACITY);
+  int32_t observed = -batteryHistory.chargeTrend();
+  if (predicted > 0 && observed > predicted) {
+    charge = charge * predicted / std::min(observed, predicted * 4);
+  }
+
+  time_t t = now();
+  microamp_t budget = stripCurrentBudget(microamp_hour_t(charge), nextDawn(t) - t,
+      load - energyMeter.getLoad(EnergyMeter::Consumer::STRIP));
+  return budget / 10000 * 10000; // change in steps of 10 mA
+}
+
+// Returns the time when something next needs to happen while asleep.
+time_t nextWakeTime(time_t t) {
+  const time_t interval = BatteryHistory::interval(BatteryHistory::Tier::SAMPLES);
+  const time_t nextSample = (t / interval + 1) * interval;
+  return std::min(nextSample, nextTimeOfDayChange(t));
+}
 } // namespace
 
 template <typename Fn>
@@ -328,14 +506,16 @@ std::unique_ptr<Menu> makePowerSavingMenu() {
   auto menu = std::make_unique<Menu>();
   menu->addItem(std::make_unique<TitleItem>("POWER"));
   menu->addItem(std::make_unique<ChoiceItem<OnOff>>("Lights", lightsOn));
+  menu->addItem(std::make_unique<NumericItem<uint8_t>>("Fade Time (0.1 s)",
+    lightsFadeTenths, 0, LIGHTS_FADE_TENTHS_MAX, 5));
   menu->addItem(std::make_unique<NumericItem<uint8_t>>("Dawn Hour",
-    dawnHour, 0, 23, 1));
+    dawnHour, 0, HOUR_MAX, 1));
   menu->addItem(std::make_unique<NumericItem<uint8_t>>("Dusk Hour",
-    duskHour, 0, 23, 1));
+    duskHour, 0, HOUR_MAX, 1));
   menu->addItem(std::make_unique<NumericItem<uint8_t>>("Night Hour",
-    nightHour, 0, 23, 1));
+    nightHour, 0, HOUR_MAX, 1));
   menu->addItem(std::make_unique<NumericItem<uint8_t>>("Display Timeout (s)",
-    activityTimeoutSeconds, 0, 240, 10));
+    activityTimeoutSeconds, 0, ACTIVITY_TIMEOUT_SECONDS_MAX, 10));
   menu->addItem(std::make_unique<ChoiceItem<LowBattery>>("Low Battery Cutoff", lowBatteryCutoff));
   menu->addItem(std::make_unique<ChoiceItem<OnOff>>("Sleep When Idle", sleepOn));
   return menu;
@@ -347,6 +527,7 @@ public:
   virtual ~BatteryMonitor() override {}
 
   void poll(Context& context) override;
+  millis_t pollInterval() const override { return 500; }
   void draw(Context& context, Canvas& canvas) override;
   bool input(Context& context, const InputEvent& event) override;
 
@@ -354,27 +535,78 @@ private:
   static constexpr uint32_t DISPLAY_WIDTH = 128;
   static constexpr uint32_t DISPLAY_HEIGHT = 64;
   static constexpr uint32_t CHART_WIDTH = 100;
-  static constexpr uint32_t CHART_HEIGHT = 36;
+  static constexpr uint32_t CHART_HEIGHT = 33;
+  static constexpr uint32_t BAND_HEIGHT = 3; // charge band below the chart
   static constexpr uint32_t CHART_X = DISPLAY_WIDTH - CHART_WIDTH - 1;
-  static constexpr uint32_t CHART_Y = DISPLAY_HEIGHT - CHART_HEIGHT - 11;
+  static constexpr uint32_t CHART_Y = DISPLAY_HEIGHT - CHART_HEIGHT - BAND_HEIGHT - 11;
+  static constexpr uint32_t BAND_Y = CHART_Y + CHART_HEIGHT + 1;
+  static constexpr uint32_t AXIS_Y = CHART_Y + CHART_HEIGHT + BAND_HEIGHT;
   static constexpr int32_t SCROLL_SPEED = 8;
   static constexpr uint32_t SCROLL_MIN = 0;
-  static constexpr uint32_t SCROLL_MAX = BatteryHistory::LENGTH - CHART_WIDTH;
-  static constexpr float VOLTAGE_MIN = 3.2f;
-  static constexpr float VOLTAGE_MAX = 4.2f;
-  static constexpr uint32_t DIVISION_MINOR = (60 * 60) / BatteryHistory::INTERVAL; // every hour
-  static constexpr uint32_t DIVISION_MAJOR = DIVISION_MINOR * 12;
-
-  enum class State {
-    DISCHARGING, CHARGING, POWERED
+  static constexpr millivolt_t VOLTAGE_MIN = 3200;
+  static constexpr millivolt_t VOLTAGE_MAX = 4200;
+  static constexpr millivolt_t VOLTAGE_MID = 3700;
+  static constexpr uint32_t MAX_LABELS = CHART_WIDTH / 28 + 1; // for the closest spaced labels
+
+  // X axis tick marks and labels in periods of the history tier.
+  struct Divisions {
+    uint32_t minor;
+    uint32_t major;
+    uint32_t perUnit;
+    char unit;
   };
 
+  struct Label {
+    uint8_t x;
+    char text[12];
+  };
+
+  static Divisions divisions(BatteryHistory::Tier tier);
+  static constexpr uint32_t elevation(millivolt_t voltage) {
+    return (std::min(std::max(voltage, VOLTAGE_MIN), VOLTAGE_MAX) - VOLTAGE_MIN)
+        * CHART_HEIGHT / (VOLTAGE_MAX - VOLTAGE_MIN);
+  }
+
+  inline uint32_t scrollMax() const {
+    return BatteryHistory::length(_tier) - CHART_WIDTH;
+  }
+
+  // Recomputes the chart columns and labels when the history advances
+  // or the view changes so that drawing doesn't need to read the history.
+  void updateChart(Canvas& canvas);
+
   time_t _time = 0;
   millivolt_t _voltage = 0;
-  uint32_t _scroll = SCROLL_MAX;
-  State _state = State::DISCHARGING;
+  BatteryHistory::Tier _tier = BatteryHistory::Tier::SAMPLES;
+  uint32_t _scroll = BatteryHistory::LENGTH - CHART_WIDTH;
+  ChargerState _state = ChargerState::DISCHARGING;
+  uint8_t _percent = 0;
+  uint32_t _hoursRemaining = 0;
+
+  bool _chartValid = false;
+  uint32_t _chartPeriod = 0;
+  uint8_t _avgElevations[CHART_WIDTH];
+  uint8_t _minElevations[CHART_WIDTH];
+  uint8_t _maxElevations[CHART_WIDTH];
+  uint8_t _tickHeights[CHART_WIDTH];
+  uint8_t _chargeBands[CHART_WIDTH]; // bit 0: on external power, bit 1: charging
+  Label _labels[MAX_LABELS];
+  uint32_t _labelCount = 0;
 };
 
+BatteryMonitor::Divisions BatteryMonitor::divisions(BatteryHistory::Tier tier) {
+  switch (tier) {
+    default:
+    case BatteryHistory::Tier::SAMPLES:
+      return Divisions{4, 48, 4, 'h'}; // every hour, label every 12 hours
+    case BatteryHistory::Tier::BIHOURLY:
+      return Divisions{12, 36, 12, 'd'}; // every day, label every 3 days
+    case BatteryHistory::Tier::DAILY:
+      return Divisions{7, 28, 1, 'd'}; // every week, label every 4 weeks
+  }
+}
+
+
 void BatteryMonitor::poll(Context& context) {
   time_t t = now();
   if (t != _time) {
@@ -383,14 +615,13 @@ void BatteryMonitor::poll(Context& context) {
     context.requestDraw();
   }
 
-  State newState = State::DISCHARGING;
-  if (!digitalRead(CHG_PIN)) {
-    newState = State::CHARGING;
-  } else if (!digitalRead(PGOOD_PIN)) {
-    newState = State::POWERED;
-  }
-  if (newState != _state) {
+  ChargerState newState = readChargerState();
+  uint8_t percent = chargeEstimator.percent();
+  uint32_t hours = chargeEstimator.hoursRemaining(lightingLoad());
+  if (newState != _state || percent != _percent || hours != _hoursRemaining) {
     _state = newState;
+    _percent = percent;
+    _hoursRemaining = hours;
     context.requestDraw();
   }
 }
@@ -404,10 +635,10 @@ void BatteryMonitor::draw(Context& context, Canvas& canvas) {
 
   canvas.gfx().setFont(u8g2_font_open_iconic_embedded_1x_t);
   switch (_state) {
-    case State::CHARGING:
+    case ChargerState::CHARGING:
       canvas.gfx().drawStr(109, 1, "C");
       break;
-    case State::POWERED:
+    case ChargerState::POWERED:
       canvas.gfx().drawStr(109, 1, "B");
       break;
     default:
@@ -415,36 +646,97 @@ void BatteryMonitor::draw(Context& context, Canvas& canvas) {
   }
   canvas.gfx().drawStr(118, 1, _voltage < 3500 ? "@" : "I");
 
+  // Draw the state of charge and how long it will last with the lights as they are
+  canvas.gfx().setFont(u8g2_font_4x6_tr);
+  canvas.gfx().setCursor(CHART_X + 2, CHART_Y - 7);
+  canvas.gfx().print(_percent);
+  canvas.gfx().print("%");
+  if (_state == ChargerState::DISCHARGING) {
+    canvas.gfx().print(", ");
+    if (_hoursRemaining < 48) {
+      canvas.gfx().print(_hoursRemaining);
+      canvas.gfx().print(" h left");
+    } else {
+      canvas.gfx().print(std::min<uint32_t>(_hoursRemaining / 24, 999));
+      canvas.gfx().print(" days left");
+    }
+  }
+
   // Draw the Y axis and labels
+  constexpr uint32_t v37elev = elevation(VOLTAGE_MID);
   canvas.gfx().setFont(u8g2_font_4x6_tr);
   canvas.gfx().drawLine(CHART_X - 1, CHART_Y, CHART_X - 1, CHART_Y + CHART_HEIGHT - 1);
   canvas.gfx().drawStr(2, CHART_Y - 3, "4.2 V");
   canvas.gfx().drawLine(CHART_X - 4, CHART_Y, CHART_X - 2, CHART_Y);
-  uint32_t v37elev = (3.7 - VOLTAGE_MIN) * CHART_HEIGHT / (VOLTAGE_MAX - VOLTAGE_MIN);
   canvas.gfx().drawStr(2, CHART_Y + CHART_HEIGHT - 1 - v37elev - 3, "3.7 V");
   canvas.gfx().drawLine(CHART_X - 4, CHART_Y + CHART_HEIGHT - 1 - v37elev, CHART_X - 2, CHART_Y + CHART_HEIGHT - 1 - v37elev);
   canvas.gfx().drawStr(2, CHART_Y + CHART_HEIGHT - 1 - 3, "3.2 V");
   canvas.gfx().drawLine(CHART_X - 4, CHART_Y + CHART_HEIGHT - 1, CHART_X - 2, CHART_Y + CHART_HEIGHT - 1);
 
   // Draw the chart and X axis labels
-  uint32_t currentPeriod = batteryHistory.currentPeriod();
+  // Summaries show the average as a bar with dots at the minimum and maximum.
+  // The band below shows when there was external power (dotted) and when the
+  // battery was charging (solid) for at least an eighth of the period.
+  updateChart(canvas);
   for (uint32_t pos = 0; pos < CHART_WIDTH; pos++) {
-    uint32_t index = pos + _scroll;
-    uint32_t period = (index + currentPeriod + 1) % BatteryHistory::LENGTH;
-    float voltage = std::min(std::max(batteryHistory.getAt(period) * 0.001f, VOLTAGE_MIN), VOLTAGE_MAX);
-    uint32_t elev = (voltage - VOLTAGE_MIN) * CHART_HEIGHT / (VOLTAGE_MAX - VOLTAGE_MIN);
     uint32_t x = pos + CHART_X;
+    uint32_t elev = _avgElevations[pos];
     canvas.gfx().drawBox(x, CHART_Y + CHART_HEIGHT - 1 - elev, 1, elev + 1);
+    if (_tier != BatteryHistory::Tier::SAMPLES) {
+      canvas.gfx().drawPixel(x, CHART_Y + CHART_HEIGHT - 1 - _minElevations[pos]);
+      canvas.gfx().drawPixel(x, CHART_Y + CHART_HEIGHT - 1 - _maxElevations[pos]);
+    }
+    if ((_chargeBands[pos] & 1) && (x & 1)) {
+      canvas.gfx().drawPixel(x, BAND_Y);
+    }
+    if (_chargeBands[pos] & 2) {
+      canvas.gfx().drawPixel(x, BAND_Y + 1);
+    }
+    if (_tickHeights[pos]) {
+      canvas.gfx().drawLine(x, AXIS_Y, x, AXIS_Y + _tickHeights[pos]);
+    }
+  }
+  for (uint32_t i = 0; i < _labelCount; i++) {
+    canvas.gfx().drawStr(_labels[i].x, AXIS_Y + 4, _labels[i].text);
+  }
+}
 
-    uint32_t age = BatteryHistory::LENGTH - index - 1;
-    if ((age % DIVISION_MAJOR) == 0) {
-      canvas.gfx().drawLine(x, CHART_Y + CHART_HEIGHT, x, CHART_Y + CHART_HEIGHT + 3);
-      String text;
-      text.append(age / DIVISION_MINOR);
-      text.append('h');
-      canvas.gfx().drawStr(x - canvas.gfx().getStrWidth(text.c_str()) + 1, CHART_Y + CHART_HEIGHT + 4, text.c_str());
-    } else if ((age % DIVISION_MINOR) == 0) {
-      canvas.gfx().drawLine(x, CHART_Y + CHART_HEIGHT, x, CHART_Y + CHART_HEIGHT + 1);
+void BatteryMonitor::updateChart(Canvas& canvas) {
+  uint32_t currentSample = batteryHistory.currentPeriod();
+  if (_chartValid && _chartPeriod == currentSample) return;
+  _chartValid = true;
+  _chartPeriod = currentSample;
+
+  const Divisions divs = divisions(_tier);
+  const uint32_t length = BatteryHistory::length(_tier);
+  uint32_t currentPeriod = batteryHistory.currentPeriod(_tier);
+  _labelCount = 0;
+  for (uint32_t pos = 0; pos < CHART_WIDTH; pos++) {
+    uint32_t index = pos + _scroll;
+    uint32_t period = (index + currentPeriod + 1) % length;
+    BatteryHistory::Reading reading = batteryHistory.getAt(_tier, period);
+    _avgElevations[pos] = elevation(reading.avg);
+    _minElevations[pos] = elevation(reading.min);
+    _maxElevations[pos] = elevation(reading.max);
+
+    uint32_t age = length - index - 1;
+    const uint32_t threshold = BatteryHistory::interval(_tier) / 60 / 8;
+    BatteryHistory::ChargeMinutes minutes = batteryHistory.getChargeMinutes(_tier, age);
+    _chargeBands[pos] = (minutes.powered >= threshold ? 1 : 0)
+        | (minutes.charging >= threshold ? 2 : 0);
+
+    if ((age % divs.major) == 0) {
+      _tickHeights[pos] = 3;
+      if (_labelCount < MAX_LABELS) {
+        Label& label = _labels[_labelCount++];
+        snprintf(label.text, sizeof(label.text), "%lu%c",
+            static_cast<unsigned long>(age / divs.perUnit), divs.unit);
+        label.x = pos + CHART_X - canvas.gfx().getStrWidth(label.text) + 1;
+      }
+    } else if ((age % divs.minor) == 0) {
+      _tickHeights[pos] = 1;
+    } else {
+      _tickHeights[pos] = 0;
     }
   }
 }
@@ -453,7 +745,16 @@ bool BatteryMonitor::input(Context& context, const InputEvent& event) {
   switch (event.type) {
     case InputType::ROTATE:
       _scroll = std::min(std::max(int32_t(_scroll) + event.value * SCROLL_SPEED,
-          int32_t(SCROLL_MIN)), int32_t(SCROLL_MAX));
+          int32_t(SCROLL_MIN)), int32_t(scrollMax()));
+      _chartValid = false;
+      context.requestDraw();
+      return true;
+    case InputType::SINGLE_CLICK:
+      // Cycle through the history tiers starting with the most recent data.
+      _tier = _tier == BatteryHistory::Tier::DAILY ? BatteryHistory::Tier::SAMPLES
+          : BatteryHistory::Tier(uint8_t(_tier) + 1);
+      _scroll = scrollMax();
+      _chartValid = false;
       context.requestDraw();
       return true;
     default:
@@ -479,6 +780,8 @@ private:
   uint8_t _index = 0;
   uint8_t _values[2] = { 200, 40 };
   time_t _time = 0;
+  bool _museumDoorClosed = false;
+  bool _libraryDoorClosed = false;
 };
 
 void BoardTest::poll(Context& context) {
@@ -487,7 +790,11 @@ void BoardTest::poll(Context& context) {
     _time = t;
     context.requestDraw();
   }
-  if (museumDoor.switched() || libraryDoor.switched()) {
+  // Compare states rather than checking for edges since the scene
+  // may not be polled on every loop.
+  if (museumDoor.on() != _museumDoorClosed || libraryDoor.on() != _libraryDoorClosed) {
+    _museumDoorClosed = museumDoor.on();
+    _libraryDoorClosed = libraryDoor.on();
     context.requestDraw();
   }
 }
@@ -566,6 +873,67 @@ std::unique_ptr<BoardTest> makeBoardTestScene() {
   return std::make_unique<BoardTest>();
 }
 
+// Lists the instrumentation counters and histograms.
+// Turn to scroll, click to reset.
+class StatsMonitor : public Scene {
+public:
+  StatsMonitor() {}
+  virtual ~StatsMonitor() override {}
+
+  void poll(Context& context) override;
+  millis_t pollInterval() const override { return 1000; }
+  void draw(Context& context, Canvas& canvas) override;
+  bool input(Context& context, const InputEvent& event) override;
+
+private:
+  static constexpr uint32_t ROWS = 8;
+  static constexpr uint32_t ROW_HEIGHT = 6;
+  static constexpr uint32_t VALUE_X = 72;
+
+  uint32_t _scroll = 0;
+};
+
+void StatsMonitor::poll(Context& context) {
+  context.requestDraw(); // values change all the time
+}
+
+void StatsMonitor::draw(Context& context, Canvas& canvas) {
+  canvas.gfx().setFont(TITLE_FONT);
+  canvas.gfx().drawStr(1, 0, "STATISTICS");
+  canvas.gfx().setFont(u8g2_font_4x6_tr);
+
+  uint32_t index = 0;
+  uint32_t y = 12;
+  for (Stat* stat = Stat::first(); stat && index < _scroll + ROWS; stat = stat->next(), index++) {
+    if (index < _scroll) continue;
+    canvas.gfx().drawStr(1, y, stat->name());
+    canvas.gfx().setCursor(VALUE_X, y);
+    stat->printSummary(canvas.gfx());
+    y += ROW_HEIGHT;
+  }
+}
+
+bool StatsMonitor::input(Context& context, const InputEvent& event) {
+  switch (event.type) {
+    case InputType::ROTATE: {
+      int32_t scrollMax = std::max<int32_t>(Stat::count() - ROWS, 0);
+      _scroll = std::min(std::max(int32_t(_scroll) + event.value, int32_t(0)), scrollMax);
+      context.requestDraw();
+      return true;
+    }
+    case InputType::SINGLE_CLICK:
+      Stat::resetAll();
+      context.requestDraw();
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::unique_ptr<StatsMonitor> makeStatsMonitorScene() {
+  return std::make_unique<StatsMonitor>();
+}
+
 std::unique_ptr<Menu> makeEepromTestMenu() {
   auto menu = std::make_unique<Menu>();
   menu->addItem(std::make_unique<TitleItem>("EEPROM TEST"));
@@ -595,6 +963,7 @@ std::unique_ptr<Menu> makeDiagnosticsMenu() {
   auto menu = std::make_unique<Menu>();
   menu->addItem(std::make_unique<TitleItem>("DIAGNOSTICS"));
   menu->addItem(std::make_unique<NavigateItem>("Board Test", makeBoardTestScene));
+  menu->addItem(std::make_unique<NavigateItem>("Statistics", makeStatsMonitorScene));
   menu->addItem(std::make_unique<NavigateItem>("Strand Test", makeStrandTestMenu));
   menu->addItem(std::make_unique<NavigateItem>("EEPROM Test", makeEepromTestMenu));
   menu->addItem(std::make_unique<NavigateItem>("Factory Reset", makeFactoryResetMenu));
@@ -613,53 +982,94 @@ std::unique_ptr<Menu> makeRootMenu() {
   return menu;
 }
 
-brightness_t museumLightBrightness() {
+brightness_t lightZoneBrightness(LightZone& zone) {
+  if (zone.door && !zone.door->on()) {
+    return zone.brightnessWhenOpen->get();
+  }
   switch (timeOfDay()) {
     case TimeOfDay::DAYTIME:
-      return museumLightBrightnessDaytime.get();
+      return zone.brightnessDaytime.get();
     case TimeOfDay::EVENING:
-      return museumLightBrightnessEvening.get();
+      return zone.brightnessEvening.get();
     case TimeOfDay::NIGHTTIME:
-      return museumLightBrightnessNighttime.get();
+      return zone.brightnessNighttime.get();
   }
   return BRIGHTNESS_OFF;
 }
 
-LightState renderMuseumLights() {
-  brightness_t brightness = museumLightBrightness();
-  if (brightness == BRIGHTNESS_OFF) return LightState::OFF;
-  
-  RGBW color = makeStripColor(museumLightTint.get(), museumLightTone.get(), brightness);
-  for (size_t i = 0; i < LIGHTS_MUSEUM_COUNT; i++) {
-    newLights[i + LIGHTS_MUSEUM_FIRST] = color;
-  }
-  return LightState::ON;
+LightZoneInputs lightZoneInputs(LightZone& zone, bool enabled) {
+  return LightZoneInputs{zone.tint.get(), zone.tone.get(),
+      enabled ? lightZoneBrightness(zone) : BRIGHTNESS_OFF};
 }
 
-brightness_t libraryLightBrightness() {
-  if (!libraryDoor.on()) {
-    return libraryLightBrightnessWhenOpen.get();
+// Everything that the lights depend on other than the passage of time
+// while animating.  Only holds the values that affect the lights so that
+// unrelated writes to the settings, such as the battery history, don't
+// cause them to be rendered again.
+struct LightInputs {
+  OnOff lightsOn;
+  StrandTestPattern strandTestPattern;
+  LightZoneInputs zones[LIGHT_ZONE_COUNT];
+  bool lowBattery;
+  microamp_t currentLimit;
+
+  bool operator==(const LightInputs& other) const {
+    return lightsOn == other.lightsOn && strandTestPattern == other.strandTestPattern
+        && std::equal(std::begin(zones), std::end(zones), std::begin(other.zones))
+        && lowBattery == other.lowBattery && currentLimit == other.currentLimit;
   }
-  switch (timeOfDay()) {
-    case TimeOfDay::DAYTIME:
-      return libraryLightBrightnessDaytime.get();
-    case TimeOfDay::EVENING:
-      return libraryLightBrightnessEvening.get();
-    case TimeOfDay::NIGHTTIME:
-      return libraryLightBrightnessNighttime.get();
+};
+
+LightInputs currentLightInputs() {
+  LightInputs inputs{lightsOn.get(), strandTestPattern.get(), {}, lowBatteryDetector.isLowBattery(),
+      std::min(batteryStripLimit, nightStripBudget)};
+  const bool enabled = inputs.lightsOn != OnOff::OFF;
+  for (size_t i = 0; i < LIGHT_ZONE_COUNT; i++) {
+    inputs.zones[i] = lightZoneInputs(lightZones[i], enabled);
   }
-  return BRIGHTNESS_OFF;
+  return inputs;
 }
 
-LightState renderLibraryLights() {
-  brightness_t brightness = libraryLightBrightness();
-  if (brightness == BRIGHTNESS_OFF) return LightState::OFF;
+// Fades the zone towards its target color and writes its lights if they changed.
+// Skips zones whose inputs are the same as last time once they have finished
+// fading and their final color has been written.
+LightState renderLightZone(LightZone& zone, const LightZoneInputs& inputs, millis_t time) {
+  if (zone.valid && inputs == zone.inputs && !zone.fade.isFading(time)
+      && zone.color == zone.fade.color(time)) {
+    return zone.color == RGBW{} ? LightState::OFF : LightState::ON;
+  }
 
-  RGBW color = makeStripColor(libraryLightTint.get(), libraryLightTone.get(), brightness);
-  for (size_t i = 0; i < LIGHTS_LIBRARY_COUNT; i++) {
-    newLights[i + LIGHTS_LIBRARY_FIRST] = color;
+  if (!zone.valid || inputs != zone.inputs) {
+    RGBW target = inputs.brightness == BRIGHTNESS_OFF ? RGBW{} :
+        makeStripColor(inputs.tint, inputs.tone, inputs.brightness);
+    zone.fade.setTarget(target, lightsFadeTenths.get() * 100UL, time);
+    zone.inputs = inputs;
   }
-  return LightState::ON;
+
+  RGBW color = zone.fade.color(time);
+  if (!zone.valid || color != zone.color) {
+    zone.color = color;
+    zone.valid = true;
+    zone.dirty = true;
+    for (size_t i = 0; i < zone.count; i++) {
+      newLights[i + zone.first] = color;
+    }
+  }
+  if (zone.fade.isFading(time)) return LightState::ANIMATING;
+  return color == RGBW{} ? LightState::OFF : LightState::ON;
+}
+
+// Clears the lights so the zones will render from scratch next time,
+// fading in from off rather than jumping back to where they were.
+void invalidateLightZones() {
+  for (size_t i = 0; i < LIGHTS_TOTAL_COUNT; i++) {
+    newLights[i] = RGBW{};
+  }
+  for (LightZone& zone : lightZones) {
+    zone.fade.reset(RGBW{});
+    zone.valid = false;
+  }
+  allLightsDirty = true;
 }
 
 LightState renderStrandTest() {
@@ -691,18 +1101,22 @@ LightState renderStrandTest() {
   }  
 }
 
-LightState renderLights() {
-  if (lowBatteryDetector.isLowBattery())
+LightState renderLights(const LightInputs& inputs) {
+  if (inputs.lowBattery) {
+    invalidateLightZones();
     return LightState::OFF;
+  }
 
-  for (size_t i = 0; i < LIGHTS_TOTAL_COUNT; i++) {
-    newLights[i] = RGBW{};
+  if (inputs.strandTestPattern != StrandTestPattern::DISABLED) {
+    invalidateLightZones();
+    return renderStrandTest();
   }
 
-  LightState state = renderStrandTest();
-  if (state == LightState::OFF && lightsOn.get() != OnOff::OFF) {
-    state = renderMuseumLights();
-    state = mergeLightState(state, renderLibraryLights());
+  // Keep rendering while the lights are switched off so they fade out
+  millis_t time = millis();
+  LightState state = LightState::OFF;
+  for (size_t i = 0; i < LIGHT_ZONE_COUNT; i++) {
+    state = mergeLightState(state, renderLightZone(lightZones[i], inputs.zones[i], time));
   }
   return state;
 }
@@ -723,10 +1137,57 @@ void setLightsEnabled(bool enabled) {
   }
 }
 
+// Copies the lights in a range that changed to the strip.
+// Returns true if any changed.
+bool updateLightRange(size_t first, size_t count) {
+  bool changed = false;
+  for (size_t i = first; i < first + count; i++) {
+    RGBW color = newLights[i].scaled(lightsCurrentScale);
+    if (oldLights[i] != color) {
+      oldLights[i] = color;
+      lights.setPixelColor(i, color.r, color.g, color.b, color.w);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
 LightState updateLights() {
+  // Skip rendering if nothing changed since the last time
+  static LightInputs oldInputs;
+  static LightState oldState;
+  static bool oldInputsValid = false;
+  LightInputs inputs = currentLightInputs();
+  if (oldInputsValid && oldState != LightState::ANIMATING && inputs == oldInputs) {
+    return oldState;
+  }
+  oldInputs = inputs;
+  oldInputsValid = true;
+
   bool changed = false;
 
-  LightState state = renderLights();
+  LightState state = renderLights(inputs);
+
+  // Dim the whole strip if it would draw more current than the battery can supply,
+  // ramping the scale so that the strip doesn't jump when the limit changes.
+  // Switch it off if there's no current to spare at all, such as when the night
+  // budget has run out, so the strip's supply isn't left on with nothing lit,
+  // and fade the zones back in from off once there is current again.
+  if (state != LightState::OFF) {
+    scale8_t target = stripCurrentScale(newLights, LIGHTS_TOTAL_COUNT, inputs.currentLimit);
+    scale8_t scale = rampStripCurrentScale(lightsCurrentScale, target);
+    if (scale != lightsCurrentScale) {
+      lightsCurrentScale = scale;
+      allLightsDirty = true;
+    }
+    if (scale != target) {
+      state = LightState::ANIMATING;
+    } else if (scale == 0) {
+      invalidateLightZones();
+      state = LightState::OFF;
+    }
+  }
+
   bool lightsEnabled = state != LightState::OFF;
   if (lightsEnabled != oldLightsEnabled) {
     oldLightsEnabled = lightsEnabled;
@@ -735,21 +1196,376 @@ LightState updateLights() {
   }
 
   if (lightsEnabled) {
-    for (size_t i = 0; i < LIGHTS_TOTAL_COUNT; i++) {
-      changed |= oldLights[i] != newLights[i];
+    // Only compare the lights in zones that were rendered again
+    if (allLightsDirty) {
+      changed |= updateLightRange(0, LIGHTS_TOTAL_COUNT);
+    } else {
+      for (LightZone& zone : lightZones) {
+        if (zone.dirty) changed |= updateLightRange(zone.first, zone.count);
+      }
     }
-  
+    allLightsDirty = false;
+    for (LightZone& zone : lightZones) {
+      zone.dirty = false;
+    }
+
     if (changed) {
-      for (size_t i = 0; i < LIGHTS_TOTAL_COUNT; i++) {
-        oldLights[i] = newLights[i];
-        lights.setPixelColor(i, newLights[i].r, newLights[i].g, newLights[i].b, newLights[i].w);
-      }
       lights.show();
     }
   }
+
+  if (changed) {
+    energyMeter.setLoad(EnergyMeter::Consumer::STRIP,
+        estimateStripCurrent(lightsEnabled, oldLights, LIGHTS_TOTAL_COUNT));
+  }
+  oldState = state;
   return state;
 }
 
+// A setting that can be read and written by name from the serial console.
+struct ConsoleSetting {
+  const char* name;
+  int32_t min, max;
+  int32_t (*get)();
+  void (*set)(int32_t value);
+};
+
+template <typename T, const Setting<T>& setting>
+ConsoleSetting consoleSetting(const char* name, T min, T max) {
+  return ConsoleSetting{name, int32_t(min), int32_t(max),
+    []() -> int32_t { return int32_t(setting.get()); },
+    [](int32_t value) { setting.set(T(value)); }
+  };
+}
+
+template <typename T, const Setting<T>& setting>
+ConsoleSetting consoleChoiceSetting(const char* name) {
+  return consoleSetting<T, setting>(name, ChoiceTraits<T>::min, ChoiceTraits<T>::max);
+}
+
+const ConsoleSetting consoleSettings[] = {
+  consoleChoiceSetting<OnOff, lightsOn>("lightsOn"),
+  consoleSetting<uint8_t, lightsFadeTenths>("lightsFadeTenths", 0, LIGHTS_FADE_TENTHS_MAX),
+  consoleSetting<uint8_t, dawnHour>("dawnHour", 0, HOUR_MAX),
+  consoleSetting<uint8_t, duskHour>("duskHour", 0, HOUR_MAX),
+  consoleSetting<uint8_t, nightHour>("nightHour", 0, HOUR_MAX),
+  consoleSetting<uint8_t, activityTimeoutSeconds>(
+      "activityTimeoutSeconds", 0, ACTIVITY_TIMEOUT_SECONDS_MAX),
+  consoleChoiceSetting<LowBattery, lowBatteryCutoff>("lowBatteryCutoff"),
+  consoleChoiceSetting<OnOff, sleepOn>("sleepOn"),
+  consoleSetting<tint_t, museumLightTint>("museumLightTint", TINT_MIN, TINT_MAX),
+  consoleSetting<tone_t, museumLightTone>("museumLightTone", TONE_MIN, TONE_MAX),
+  consoleSetting<brightness_t, museumLightBrightnessDaytime>(
+      "museumLightBrightnessDaytime", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleSetting<brightness_t, museumLightBrightnessEvening>(
+      "museumLightBrightnessEvening", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleSetting<brightness_t, museumLightBrightnessNighttime>(
+      "museumLightBrightnessNighttime", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleSetting<tint_t, libraryLightTint>("libraryLightTint", TINT_MIN, TINT_MAX),
+  consoleSetting<tone_t, libraryLightTone>("libraryLightTone", TONE_MIN, TONE_MAX),
+  consoleSetting<brightness_t, libraryLightBrightnessDaytime>(
+      "libraryLightBrightnessDaytime", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleSetting<brightness_t, libraryLightBrightnessEvening>(
+      "libraryLightBrightnessEvening", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleSetting<brightness_t, libraryLightBrightnessNighttime>(
+      "libraryLightBrightnessNighttime", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleSetting<brightness_t, libraryLightBrightnessWhenOpen>(
+      "libraryLightBrightnessWhenOpen", BRIGHTNESS_MIN, BRIGHTNESS_MAX),
+  consoleChoiceSetting<StrandTestPattern, strandTestPattern>("strandTestPattern"),
+};
+constexpr size_t CONSOLE_SETTING_COUNT = sizeof(consoleSettings) / sizeof(consoleSettings[0]);
+
+const ConsoleSetting* findConsoleSetting(const char* name) {
+  for (const ConsoleSetting& setting : consoleSettings) {
+    if (strcmp(setting.name, name) == 0) return &setting;
+  }
+  return nullptr;
+}
+
+void printConsoleSetting(Print& printer, const ConsoleSetting& setting) {
+  printer.print(setting.name);
+  printer.print(" = ");
+  printer.println(setting.get());
+}
+
+void printHex32(Print& printer, uint32_t value) {
+  for (int shift = 28; shift >= 0; shift -= 4) {
+    printer.print("0123456789abcdef"[(value >> shift) & 0xf]);
+  }
+}
+
+void writeLittleEndian(Print& printer, uint32_t value, size_t size) {
+  uint8_t bytes[4];
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = uint8_t(value >> (i * 8));
+  }
+  printer.write(bytes, size);
+}
+
+// Battery history export.
+//
+// CSV has a header row then one row per period, oldest first, and ends
+// with a comment holding the CRC-32 of everything before it.  Missing
+// readings are left blank.
+//
+// Binary is little-endian:
+//   header:  "LFTH", version (u8), tier (u8), periods (u16),
+//            interval in seconds (u32), start time of the first period (u32)
+//   periods: min, avg, max millivolts, charging and powered minutes (u16 each),
+//            voltages are 0 when missing
+//   trailer: CRC-32 of the header and periods (u32)
+constexpr uint8_t HISTORY_EXPORT_VERSION = 1;
+
+struct HistoryExport {
+  BatteryHistory::Tier tier;
+  bool binary;
+  uint32_t currentPeriod;
+  time_t currentPeriodTime;
+  time_t time; // when the export started, so rows don't shift while streaming
+} historyExport;
+
+bool exportHistoryChunk(Console& console, uint32_t index) {
+  const HistoryExport& e = historyExport;
+  const uint32_t length = BatteryHistory::length(e.tier);
+  const time_t interval = BatteryHistory::interval(e.tier);
+  Print& out = console.out();
+
+  if (index == 0) {
+    if (e.binary) {
+      out.write(reinterpret_cast<const uint8_t*>("LFTH"), 4);
+      writeLittleEndian(out, HISTORY_EXPORT_VERSION, 1);
+      writeLittleEndian(out, uint8_t(e.tier), 1);
+      writeLittleEndian(out, length, 2);
+      writeLittleEndian(out, interval, 4);
+      writeLittleEndian(out, e.currentPeriodTime - (length - 1) * interval, 4);
+    } else {
+      out.println("time,min_mv,avg_mv,max_mv,charging_min,powered_min");
+    }
+    return true;
+  }
+
+  if (index <= length) {
+    const uint32_t age = length - index;
+    const uint32_t period = (e.currentPeriod + index) % length;
+    const BatteryHistory::Reading reading = batteryHistory.getAt(e.tier, period);
+    const BatteryHistory::ChargeMinutes minutes = batteryHistory.getChargeMinutes(e.tier, age, e.time);
+    const bool missing = BatteryHistory::isMissing(reading);
+    if (e.binary) {
+      writeLittleEndian(out, missing ? 0 : reading.min, 2);
+      writeLittleEndian(out, missing ? 0 : reading.avg, 2);
+      writeLittleEndian(out, missing ? 0 : reading.max, 2);
+      writeLittleEndian(out, minutes.charging, 2);
+      writeLittleEndian(out, minutes.powered, 2);
+    } else {
+      out.print(uint32_t(e.currentPeriodTime - age * interval));
+      out.print(',');
+      if (!missing) {
+        out.print(reading.min);
+        out.print(',');
+        out.print(reading.avg);
+        out.print(',');
+        out.print(reading.max);
+      } else {
+        out.print(",,");
+      }
+      out.print(',');
+      out.print(minutes.charging);
+      out.print(',');
+      out.println(minutes.powered);
+    }
+    return true;
+  }
+
+  const uint32_t crc = console.crc();
+  if (e.binary) {
+    writeLittleEndian(out, crc, 4);
+  } else {
+    out.print("# crc32 ");
+    printHex32(out, crc);
+    out.println();
+  }
+  return false;
+}
+
+void historyCommand(Console& console, char* args) {
+  const char* format = Console::nextWord(&args);
+  const char* tier = Console::nextWord(&args);
+  HistoryExport& e = historyExport;
+  if (strcmp(format, "csv") == 0) {
+    e.binary = false;
+  } else if (strcmp(format, "bin") == 0) {
+    e.binary = true;
+  } else {
+    console.out().println("error: format must be csv or bin");
+    return;
+  }
+  if (!*tier || strcmp(tier, "samples") == 0) {
+    e.tier = BatteryHistory::Tier::SAMPLES;
+  } else if (strcmp(tier, "bihourly") == 0) {
+    e.tier = BatteryHistory::Tier::BIHOURLY;
+  } else if (strcmp(tier, "daily") == 0) {
+    e.tier = BatteryHistory::Tier::DAILY;
+  } else {
+    console.out().println("error: tier must be samples, bihourly, or daily");
+    return;
+  }
+
+  const time_t interval = BatteryHistory::interval(e.tier);
+  e.time = now();
+  e.currentPeriod = e.time / interval % BatteryHistory::length(e.tier);
+  e.currentPeriodTime = e.time / interval * interval;
+  console.beginStream(exportHistoryChunk);
+}
+
+void getCommand(Console& console, char* args) {
+  const char* name = Console::nextWord(&args);
+  if (*name) {
+    const ConsoleSetting* setting = findConsoleSetting(name);
+    if (setting) {
+      printConsoleSetting(console.out(), *setting);
+    } else {
+      console.out().println("error: unknown setting");
+    }
+    return;
+  }
+
+  console.beginStream([](Console& console, uint32_t index) -> bool {
+    if (index >= CONSOLE_SETTING_COUNT) return false;
+    printConsoleSetting(console.out(), consoleSettings[index]);
+    return true;
+  });
+}
+
+void setCommand(Console& console, char* args) {
+  const char* name = Console::nextWord(&args);
+  const char* text = Console::nextWord(&args);
+  const ConsoleSetting* setting = findConsoleSetting(name);
+  if (!setting) {
+    console.out().println("error: unknown setting");
+    return;
+  }
+
+  char* end;
+  const long value = strtol(text, &end, 10);
+  if (!*text || *end || value < setting->min || value > setting->max) {
+    console.out().print("error: value must be from ");
+    console.out().print(setting->min);
+    console.out().print(" to ");
+    console.out().println(setting->max);
+    return;
+  }
+
+  setting->set(value);
+  Settings::commit();
+  printConsoleSetting(console.out(), *setting);
+}
+
+// Streams the energy report a line per chunk.
+bool streamEnergyReport(Console& console, uint32_t index) {
+  if (index >= EnergyMeter::REPORT_LINES) return false;
+  energyMeter.printReportLine(console.out(), index);
+  return true;
+}
+
+// Streams the task report a line per chunk.
+bool streamTaskReport(Console& console, uint32_t index) {
+  if (index >= scheduler.reportLineCount()) return false;
+  scheduler.printReportLine(console.out(), index);
+  return true;
+}
+
+Stat* statsCursor;
+unsigned statsCursorLine;
+
+// Streams every stat a line per chunk since histograms span several lines.
+bool streamStats(Console& console, uint32_t index) {
+  if (index == 0) {
+    statsCursor = Stat::first();
+    statsCursorLine = 0;
+  }
+  while (statsCursor && statsCursorLine >= statsCursor->lineCount()) {
+    statsCursor = statsCursor->next();
+    statsCursorLine = 0;
+  }
+  if (!statsCursor) return false;
+  statsCursor->printLine(console.out(), statsCursorLine++);
+  return true;
+}
+
+// The hourly report waits until the console is free instead of being dropped.
+bool hourlyReportPending = false;
+unsigned hourlyReportSection;
+uint32_t hourlyReportSectionStart;
+
+// Streams the energy, stats, and task reports in turn then starts the
+// task statistics over for the next hour.
+bool streamHourlyReport(Console& console, uint32_t index) {
+  static const Console::Producer SECTIONS[] = {
+    streamEnergyReport, streamStats, streamTaskReport
+  };
+  constexpr unsigned SECTION_COUNT = sizeof(SECTIONS) / sizeof(SECTIONS[0]);
+
+  if (index == 0) {
+    hourlyReportSection = 0;
+    hourlyReportSectionStart = 0;
+  }
+  while (hourlyReportSection < SECTION_COUNT) {
+    if (SECTIONS[hourlyReportSection](console, index - hourlyReportSectionStart)) return true;
+    hourlyReportSection++;
+    hourlyReportSectionStart = index;
+  }
+  scheduler.resetStats();
+  return false;
+}
+
+void statsCommand(Console& console, char* args) {
+  if (strcmp(Console::nextWord(&args), "reset") == 0) {
+    Stat::resetAll();
+    scheduler.resetStats();
+    console.out().println("reset");
+    return;
+  }
+  console.beginStream(streamStats);
+}
+
+void batteryCommand(Console& console, char* args) {
+  static const char* const CHARGER_STATES[] = {"discharging", "charging", "powered"};
+  Print& out = console.out();
+  out.print(battery.read());
+  out.print(" mV, ");
+  out.print(chargeEstimator.percent());
+  out.print("%, ");
+  out.print(CHARGER_STATES[unsigned(chargeEstimator.chargerState())]);
+  out.print(", trend ");
+  out.print(batteryHistory.chargeTrend());
+  out.print(" %/100h, ");
+  out.print(chargeEstimator.hoursRemaining(lightingLoad()));
+  out.println(" h remaining");
+}
+
+void helpCommand(Console& console, char* args);
+
+const Console::Command consoleCommands[] = {
+  {"help", "", helpCommand},
+  {"get", "[setting]", getCommand},
+  {"set", "<setting> <value>", setCommand},
+  {"history", "csv|bin [samples|bihourly|daily]", historyCommand},
+  {"battery", "", batteryCommand},
+  {"stats", "[reset]", statsCommand},
+  {"energy", "", [](Console& console, char* args) {
+    console.beginStream(streamEnergyReport);
+  }},
+  {"tasks", "", [](Console& console, char* args) {
+    console.beginStream(streamTaskReport);
+  }},
+};
+
+void helpCommand(Console& console, char* args) {
+  console.printHelp();
+}
+
+Console console(Serial, consoleCommands, sizeof(consoleCommands) / sizeof(consoleCommands[0]));
+
 void setup() {
   // Configure the time library to use the hardware RTC
   setSyncProvider([]() -> time_t { return Teensy3Clock.get(); } );
@@ -767,9 +1583,10 @@ void setup() {
   Serial.println();
 
   // Initialize the settings
-  settings.begin(SETTINGS_SCHEMA_VERSION, resetSettings);
+  settings.begin(SETTINGS_SCHEMA_VERSION, resetSettings, migrateSettings);
   battery.begin();
   batteryHistory.begin();
+  energyMeter.begin();
 
   // Initialize panel
   panel.begin(snoozeDigital);
@@ -786,16 +1603,95 @@ void setup() {
   // Initialize battery monitor
   pinMode(CHG_PIN, INPUT);
   pinMode(PGOOD_PIN, INPUT);
+  // Wake when the charger changes state so the charge log stays accurate
+  snoozeDigital.pinMode(CHG_PIN, INPUT, CHANGE);
+  snoozeDigital.pinMode(PGOOD_PIN, INPUT, CHANGE);
+
+  // Schedule tasks in the order they should run when due at the same time
+  scheduler.addTask("battery", []() -> millis_t {
+    battery.update();
+    batteryStripLimit = stripCurrentLimit(battery.read(), batteryStripLimit);
+    return Battery::SAMPLE_INTERVAL;
+  });
+  scheduler.addTask("history", []() -> millis_t {
+    batteryHistory.update();
+    nightStripBudget = computeNightStripBudget();
+    nightBudgetMilliamps.add(nightStripBudget / 1000);
+    if (lightState != LightState::OFF) {
+      stripScalePercent.add(lightsCurrentScale * 100 / SCALE8_ONE);
+    }
+    if (energyMeter.update()) {
+      // Report energy consumption over USB serial at the top of each hour.
+      // The report resets the task statistics once it has been sent.
+      if (Serial) {
+        hourlyReportPending = true;
+      } else {
+        scheduler.resetStats();
+      }
+    }
+    return 1000;
+  });
+  scheduler.addTask("inputs", []() -> millis_t {
+    // Poll often enough for the switches to debounce
+    museumDoor.poll();
+    libraryDoor.poll();
+    panel.update();
+    return 5;
+  });
+  scheduler.addTask("ui", []() -> millis_t {
+    stage.update();
+    energyMeter.setLoad(EnergyMeter::Consumer::PANEL,
+        estimatePanelCurrent(!stage.isAsleep(), panel.displayColor(), panel.knobColor()));
+    return 5;
+  });
+  scheduler.addTask("lights", []() -> millis_t {
+    lightState = updateLights();
+    return lightState == LightState::ANIMATING ? 10 : 20;
+  });
+  scheduler.addTask("settings", []() -> millis_t {
+    settings.update();
+    return 100;
+  });
+  scheduler.addTask("console", []() -> millis_t {
+    if (!Serial) {
+      console.reset();
+      if (hourlyReportPending) {
+        hourlyReportPending = false;
+        scheduler.resetStats();
+      }
+      return 100;
+    }
+    if (hourlyReportPending && !console.isBusy()) {
+      hourlyReportPending = false;
+      console.beginStream(streamHourlyReport);
+    }
+    console.update();
+    return console.isBusy() ? 2 : 10;
+  });
 
-  // Setup sleeping
-  // Periodically wake to update battery stats
-  snoozeTimer.setTimer(60000);
 #if USE_BUILTIN_LED
   pinMode(LED_BUILTIN, OUTPUT);
   digitalWrite(LED_BUILTIN, HIGH);
 #endif
 }
 
+// Snooze reports digital wakeups by pin number and others by an internal
+// driver number, so treat any other wakeup once the alarm time has been
+// reached as the alarm instead of relying on that number.
+void countWakeSource(int source, bool alarmDue) {
+  if (source == MUSEUM_DOOR_PIN || source == LIBRARY_DOOR_PIN) {
+    wakeByDoor.add();
+  } else if (Panel::isWakePin(source)) {
+    wakeByPanel.add();
+  } else if (source == CHG_PIN || source == PGOOD_PIN) {
+    wakeByCharger.add();
+  } else if (alarmDue) {
+    wakeByAlarm.add();
+  } else {
+    wakeByOther.add(); // such as USB
+  }
+}
+
 bool sleepWhenReady(bool canSleep) {
   static uint32_t readyToSleepAt = 0;
   if (!canSleep) {
@@ -821,7 +1717,34 @@ bool sleepWhenReady(bool canSleep) {
   // Go to sleep.  We can't use deepSleep() because not all of the inputs
   // we need to monitor support low-level wakeups (see LLWU matrix in processor
   // documentation).
-  Snooze.sleep(snoozeBlock);
+  // Commit pending settings now since we may be asleep for a while.
+  settings.flush();
+
+  // Wake up for the next battery sample or change in the time of day,
+  // whichever comes first.
+  time_t rtcTime = Teensy3Clock.get();
+  time_t wakeDelay = std::max<time_t>(nextWakeTime(rtcTime) - rtcTime, 1);
+  snoozeAlarm.setRtcTimer(wakeDelay / SECS_PER_HOUR,
+      wakeDelay / SECS_PER_MIN % 60, wakeDelay % SECS_PER_MIN);
+
+  static uint32_t wakeTime = 0;
+  awakeMillis.add(millis() - wakeTime);
+  sleepCount.add();
+
+  energyMeter.beginSleep();
+  int wakeSource = Snooze.sleep(snoozeBlock);
+  energyMeter.endSleep();
+
+  wakeTime = millis();
+  const time_t wokeAt = Teensy3Clock.get();
+  asleepSeconds.add(wokeAt - rtcTime);
+  countWakeSource(wakeSource, wokeAt >= rtcTime + wakeDelay);
+
+  // The millisecond clock stops while asleep so resynchronize the time.
+  setTime(wokeAt);
+
+  // The battery voltage may have changed a lot while asleep.
+  battery.reset();
 
 #if USE_BUILTIN_LED
   digitalWrite(LED_BUILTIN, HIGH);
@@ -832,23 +1755,18 @@ bool sleepWhenReady(bool canSleep) {
 }
 
 void loop() {
-  // Update statistics
-  batteryHistory.update();
-  
-  // Update sensors
-  museumDoor.poll();
-  libraryDoor.poll();
-
-  // Update user interface and LEDs
-  panel.update();
-  stage.update();
-  LightState state = updateLights();
+  uint32_t start = micros();
+  scheduler.run();
+  loopMicros.add(micros() - start);
 
   // Go to sleep if nothing else going on
-  bool canSleep = sleepOn.get() == OnOff::ON && state != LightState::ANIMATING
-      && panel.canSleep() && stage.canSleep();
-  if (!sleepWhenReady(canSleep)) {
-    // Save about 3 mA by throttling the loop a little
-    delay(5);
+  bool canSleep = sleepOn.get() == OnOff::ON && lightState != LightState::ANIMATING
+      && panel.canSleep() && stage.canSleep() && !console.isBusy();
+  if (sleepWhenReady(canSleep)) {
+    // Catch up on everything that happened while asleep
+    scheduler.wake();
+  } else {
+    // Idle until the next task is due rather than spinning
+    scheduler.idle();
   }
 }
@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include "energy.h"
+
+namespace {
+constexpr uint64_t MICROAMP_MILLIS_PER_MICROAMP_HOUR = 60 * 60 * 1000ULL;
+constexpr unsigned PANEL_PIXEL_COUNT = 3;
+
+microamp_t channelCurrent(uint8_t level, microamp_t fullScale) {
+  return level * fullScale / 255;
+}
+} // namespace
+
+microamp_t estimatePanelCurrent(bool displayOn, RGB display, RGB knob) {
+  microamp_t current = PANEL_PIXEL_COUNT * PANEL_PIXEL_QUIESCENT_CURRENT;
+  if (displayOn) current += LCD_CURRENT;
+  current += channelCurrent(display.r, PANEL_CHANNEL_CURRENT)
+      + channelCurrent(display.g, PANEL_CHANNEL_CURRENT)
+      + channelCurrent(display.b, PANEL_CHANNEL_CURRENT);
+  current += 2 * (channelCurrent(knob.r, PANEL_CHANNEL_CURRENT)
+      + channelCurrent(knob.g, PANEL_CHANNEL_CURRENT)
+      + channelCurrent(knob.b, PANEL_CHANNEL_CURRENT));
+  return current;
+}
+
+microamp_t estimateStripCurrent(bool enabled, const RGBW* pixels, size_t count) {
+  if (!enabled) return 0;
+
+  uint32_t rgb = 0;
+  uint32_t w = 0;
+  for (size_t i = 0; i < count; i++) {
+    rgb += pixels[i].r + pixels[i].g + pixels[i].b;
+    w += pixels[i].w;
+  }
+  return count * STRIP_PIXEL_QUIESCENT_CURRENT
+      + rgb * STRIP_CHANNEL_CURRENT_RGB / 255
+      + w * STRIP_CHANNEL_CURRENT_W / 255;
+}
+
+microamp_t stripCurrentLimit(uint32_t batteryMillivolts) {
+  uint32_t millivolts = batteryMillivolts / 100 * 100;
+  if (millivolts >= STRIP_CURRENT_LIMIT_HIGH_MILLIVOLTS) return STRIP_CURRENT_LIMIT_HIGH;
+  if (millivolts <= STRIP_CURRENT_LIMIT_LOW_MILLIVOLTS) return STRIP_CURRENT_LIMIT_LOW;
+  return STRIP_CURRENT_LIMIT_LOW
+      + (STRIP_CURRENT_LIMIT_HIGH - STRIP_CURRENT_LIMIT_LOW)
+      * (millivolts - STRIP_CURRENT_LIMIT_LOW_MILLIVOLTS)
+      / (STRIP_CURRENT_LIMIT_HIGH_MILLIVOLTS - STRIP_CURRENT_LIMIT_LOW_MILLIVOLTS);
+}
+
+microamp_t stripCurrentLimit(uint32_t batteryMillivolts, microamp_t previousLimit) {
+  microamp_t limit = stripCurrentLimit(batteryMillivolts);
+  if (limit <= previousLimit) return limit;
+
+  const uint32_t recovered = batteryMillivolts > STRIP_CURRENT_LIMIT_HYSTERESIS_MILLIVOLTS
+      ? batteryMillivolts - STRIP_CURRENT_LIMIT_HYSTERESIS_MILLIVOLTS : 0;
+  return std::max(stripCurrentLimit(recovered), previousLimit);
+}
+
+microamp_t stripCurrentBudget(microamp_hour_t charge, uint32_t seconds, microamp_t baseLoad) {
+  if (seconds == 0) return STRIP_CURRENT_LIMIT_HIGH;
+  uint64_t average = uint64_t(charge) * 3600 / seconds;
+  if (average <= baseLoad) return 0;
+  return microamp_t(std::min<uint64_t>(average - baseLoad, STRIP_CURRENT_LIMIT_HIGH));
+}
+
+scale8_t stripCurrentScale(const RGBW* pixels, size_t count, microamp_t limit) {
+  // Only the current drawn by the channels scales with brightness.
+  microamp_t quiescent = count * STRIP_PIXEL_QUIESCENT_CURRENT;
+  microamp_t current = estimateStripCurrent(true, pixels, count);
+  if (current <= limit) return SCALE8_ONE;
+  if (limit <= quiescent) return 0;
+  return scale8_t(uint64_t(limit - quiescent) * SCALE8_ONE / (current - quiescent));
+}
+
+scale8_t rampStripCurrentScale(scale8_t scale, scale8_t target) {
+  if (target > scale) return scale8_t(std::min<uint32_t>(scale + STRIP_CURRENT_SCALE_STEP, target));
+  if (target + STRIP_CURRENT_SCALE_STEP < scale) return scale8_t(scale - STRIP_CURRENT_SCALE_STEP);
+  return target;
+}
+
+void EnergyMeter::begin() {
+  _hourIndex = now() / SECS_PER_HOUR;
+  _lastUpdateTime = millis();
+}
+
+void EnergyMeter::setLoad(Consumer consumer, microamp_t current) {
+  _loads[unsigned(consumer)] = current;
+}
+
+bool EnergyMeter::update() {
+  uint32_t time = millis();
+  bool newHour = advanceToHour(now() / SECS_PER_HOUR);
+  accumulate(_hourIndex, time - _lastUpdateTime, false);
+  _lastUpdateTime = time;
+  return newHour;
+}
+
+void EnergyMeter::beginSleep() {
+  update();
+  _sleepTime = Teensy3Clock.get();
+}
+
+void EnergyMeter::endSleep() {
+  // Split the time asleep at hour boundaries.
+  time_t start = _sleepTime;
+  time_t end = Teensy3Clock.get();
+  while (start < end) {
+    uint32_t hourIndex = start / SECS_PER_HOUR;
+    time_t next = std::min(end, time_t((hourIndex + 1) * SECS_PER_HOUR));
+    advanceToHour(hourIndex);
+    accumulate(hourIndex, (next - start) * 1000, true);
+    start = next;
+  }
+  _lastUpdateTime = millis();
+}
+
+microamp_hour_t EnergyMeter::getAt(uint32_t hour, Consumer consumer) const {
+  return _hours[hour % HOURS][unsigned(consumer)];
+}
+
+void EnergyMeter::printReportLine(Print& printer, unsigned line) const {
+  if (line == 0) {
+    printer.println("Hour  Awake  Asleep  Panel  Strip  Total mAh");
+    return;
+  }
+
+  uint32_t hour = (_hourIndex + line) % HOURS;
+  microamp_hour_t total = 0;
+  if (hour < 10) printer.print('0');
+  printer.print(hour);
+  printer.print(":00");
+  for (unsigned consumer = 0; consumer < CONSUMERS; consumer++) {
+    microamp_hour_t charge = _hours[hour][consumer];
+    total += charge;
+    printer.print("  ");
+    printer.print(charge * 0.001f, 1);
+  }
+  printer.print("  ");
+  printer.print(total * 0.001f, 1);
+  printer.println();
+}
+
+bool EnergyMeter::advanceToHour(uint32_t hourIndex) {
+  if (hourIndex <= _hourIndex) return false;
+
+  // Clear the hours that have been skipped over, such as when the clock is set.
+  uint32_t cleared = 0;
+  while (_hourIndex < hourIndex && cleared < HOURS) {
+    _hourIndex++;
+    cleared++;
+    for (unsigned consumer = 0; consumer < CONSUMERS; consumer++) {
+      _hours[_hourIndex % HOURS][consumer] = 0;
+    }
+  }
+  _hourIndex = hourIndex;
+  return true;
+}
+
+void EnergyMeter::accumulate(uint32_t hourIndex, uint32_t millis, bool asleep) {
+  microamp_t loads[CONSUMERS];
+  std::copy(_loads, _loads + CONSUMERS, loads);
+  loads[unsigned(Consumer::MCU_AWAKE)] = asleep ? 0 : MCU_AWAKE_CURRENT;
+  loads[unsigned(Consumer::MCU_ASLEEP)] = asleep ? MCU_ASLEEP_CURRENT : 0;
+
+  microamp_hour_t* hour = _hours[hourIndex % HOURS];
+  for (unsigned consumer = 0; consumer < CONSUMERS; consumer++) {
+    uint64_t residue = _residue[consumer] + uint64_t(loads[consumer]) * millis;
+    hour[consumer] += residue / MICROAMP_MILLIS_PER_MICROAMP_HOUR;
+    _residue[consumer] = residue % MICROAMP_MILLIS_PER_MICROAMP_HOUR;
+  }
+}
@@ -0,0 +1,122 @@
+/*
+ * Energy consumption estimates.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Print.h>
+#include <TimeLib.h>
+
+#include "utils.h"
+
+using microamp_t = uint32_t;
+using microamp_hour_t = uint32_t;
+
+// Approximate current drawn from the battery by each part of the system.
+// Rough figures taken from the component datasheets so treat them as estimates.
+constexpr microamp_t MCU_AWAKE_CURRENT = 30000;
+constexpr microamp_t MCU_ASLEEP_CURRENT = 2000;
+constexpr microamp_t LCD_CURRENT = 300;
+constexpr microamp_t PANEL_PIXEL_QUIESCENT_CURRENT = 600;
+constexpr microamp_t PANEL_CHANNEL_CURRENT = 12000; // per channel at full scale
+constexpr microamp_t STRIP_PIXEL_QUIESCENT_CURRENT = 1000;
+constexpr microamp_t STRIP_CHANNEL_CURRENT_RGB = 16000; // per channel at full scale
+constexpr microamp_t STRIP_CHANNEL_CURRENT_W = 20000; // at full scale
+
+// Estimates the current drawn by the panel's LCD and LEDs.
+microamp_t estimatePanelCurrent(bool displayOn, RGB display, RGB knob);
+
+// Estimates the current drawn by an RGBW LED strip.
+microamp_t estimateStripCurrent(bool enabled, const RGBW* pixels, size_t count);
+
+// Limits on the current drawn by the LED strip.  Less current is allowed as the
+// battery discharges so its voltage doesn't sag enough under load to trip the
+// low battery cutoff or brown out the microcontroller.
+constexpr uint32_t STRIP_CURRENT_LIMIT_HIGH_MILLIVOLTS = 3900;
+constexpr uint32_t STRIP_CURRENT_LIMIT_LOW_MILLIVOLTS = 3400;
+constexpr microamp_t STRIP_CURRENT_LIMIT_HIGH = 1200000;
+constexpr microamp_t STRIP_CURRENT_LIMIT_LOW = 300000;
+
+// Only raise the limit once the voltage is this far above the step so that the
+// strip doesn't pump when its own load pulls the voltage back below the step.
+constexpr uint32_t STRIP_CURRENT_LIMIT_HYSTERESIS_MILLIVOLTS = 50;
+
+// Gets the maximum current to draw from the battery for the LED strip at the
+// given battery voltage.  Changes in steps of 100 mV to avoid chasing noise.
+microamp_t stripCurrentLimit(uint32_t batteryMillivolts);
+
+// Like above but with hysteresis: lowers the previous limit as soon as the
+// voltage drops and raises it only once the voltage has recovered.
+microamp_t stripCurrentLimit(uint32_t batteryMillivolts, microamp_t previousLimit);
+
+// Gets the average current that the LED strip can draw to use up the given
+// charge over the given number of seconds while the rest of the system
+// draws the base load.
+microamp_t stripCurrentBudget(microamp_hour_t charge, uint32_t seconds, microamp_t baseLoad);
+
+// Gets the scale to apply to an RGBW LED strip's pixels so that it draws
+// no more than the given current.
+scale8_t stripCurrentScale(const RGBW* pixels, size_t count, microamp_t limit);
+
+// Changes the strip's current scale by at most this much per update so that
+// it dims and brightens gradually when the current limit changes.
+constexpr scale8_t STRIP_CURRENT_SCALE_STEP = SCALE8_ONE / 32;
+
+// Moves the strip's current scale one step towards the target.
+scale8_t rampStripCurrentScale(scale8_t scale, scale8_t target);
+
+// Attributes the charge drawn from the battery to its consumers based on
+// how long they spend in each state and keeps a record for each hour of the day.
+class EnergyMeter {
+public:
+  enum class Consumer : uint8_t {
+    MCU_AWAKE, MCU_ASLEEP, PANEL, STRIP, COUNT
+  };
+
+  constexpr static unsigned HOURS = 24;
+  constexpr static unsigned CONSUMERS = unsigned(Consumer::COUNT);
+
+  EnergyMeter() {}
+  ~EnergyMeter() = default;
+
+  void begin();
+
+  // Sets the current drawn by the panel or strip until further notice.
+  void setLoad(Consumer consumer, microamp_t current);
+  inline microamp_t getLoad(Consumer consumer) const { return _loads[unsigned(consumer)]; }
+
+  // Accumulates the charge drawn while awake since the last update.
+  // Returns true if a new hour has started since the last update.
+  bool update();
+
+  // Call immediately before and after sleeping to account for the time
+  // spent asleep.  The millisecond clock does not advance during sleep so
+  // this uses the real-time clock instead.
+  void beginSleep();
+  void endSleep();
+
+  // Gets the charge drawn by a consumer during the given hour of the day.
+  microamp_hour_t getAt(uint32_t hour, Consumer consumer) const;
+
+  // Prints a table of the charge drawn during each of the last 24 hours
+  // a line at a time, a heading followed by a line per hour.
+  constexpr static unsigned REPORT_LINES = HOURS + 1;
+  void printReportLine(Print& printer, unsigned line) const;
+
+private:
+  EnergyMeter(const EnergyMeter&) = delete;
+  EnergyMeter(EnergyMeter&&) = delete;
+  EnergyMeter& operator=(const EnergyMeter&) = delete;
+  EnergyMeter& operator=(EnergyMeter&&) = delete;
+
+  void accumulate(uint32_t hourIndex, uint32_t millis, bool asleep);
+  bool advanceToHour(uint32_t hourIndex);
+
+  microamp_t _loads[CONSUMERS] = {};
+  microamp_hour_t _hours[HOURS][CONSUMERS] = {};
+  uint64_t _residue[CONSUMERS] = {}; // microamp-milliseconds not yet a whole microamp-hour
+  uint32_t _hourIndex = 0;
+  uint32_t _lastUpdateTime = 0;
+  time_t _sleepTime = 0;
+};
@@ -0,0 +1,22 @@
+#include "lights.h"
+
+void Fade::setTarget(RGBW target, millis_t duration, millis_t time) {
+  if (target == _target) return;
+
+  _from = color(time);
+  _target = target;
+  _startTime = time;
+  _duration = duration;
+}
+
+void Fade::reset(RGBW color) {
+  _from = color;
+  _target = color;
+  _duration = 0;
+}
+
+RGBW Fade::color(millis_t time) const {
+  millis_t elapsed = time - _startTime;
+  if (elapsed >= _duration) return _target;
+  return RGBW::lerp(_from, _target, scale8_t(elapsed * SCALE8_ONE / _duration));
+}
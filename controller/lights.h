@@ -0,0 +1,42 @@
+/*
+ * Lighting effects for the LED strip.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "utils.h"
+
+using millis_t = uint32_t;
+
+// Fades a color smoothly towards a target over a period of time.
+class Fade {
+public:
+  Fade() {}
+  ~Fade() = default;
+
+  // Starts fading from the current color to a new target over the given duration.
+  // Does nothing if already fading towards that target.
+  void setTarget(RGBW target, millis_t duration, millis_t time);
+
+  // Jumps to a color immediately so the next target fades from there.
+  void reset(RGBW color);
+
+  // Gets the color at the given time.
+  RGBW color(millis_t time) const;
+
+  // Returns true if the color is still changing at the given time.
+  inline bool isFading(millis_t time) const { return time - _startTime < _duration; }
+
+private:
+  Fade(const Fade&) = delete;
+  Fade(Fade&&) = delete;
+  Fade& operator=(const Fade&) = delete;
+  Fade& operator=(Fade&&) = delete;
+
+  RGBW _from{};
+  RGBW _target{};
+  millis_t _startTime = 0;
+  millis_t _duration = 0;
+};
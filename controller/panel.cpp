@@ -1,6 +1,7 @@
 #include <SPI.h>
 
 #include "panel.h"
+#include "stats.h"
 #include "utils.h"
 
 namespace {
@@ -22,13 +23,16 @@ const int BEEP = 6;
 const int BTN_ENC = 19;
 const int BTN_EN1 = 15;
 const int BTN_EN2 = 16;
+
+Counter knobStepsDropped("Knob steps dropped");
 } // namespace
 
+Panel* Panel::_instance = nullptr;
+
 Panel::Panel() :
     _display(LCD_ROTATION, LCD_CS, LCD_A0, LCD_RST),
     _leds(3, LED_DIN, NEO_RGB | NEO_KHZ800),
     _knobEncoder(BTN_EN2, BTN_EN1),
-    _knobRotations(0),
     _knobButton(BTN_ENC, INPUT_PULLUP),
     _killButton(SW_KILL, INPUT) {
 }
@@ -48,6 +52,9 @@ void Panel::begin(SnoozeDigital& snoozeDigital) {
 
   // Initialize the rotary encoder
   _knobEncoder.begin();
+  _instance = this;
+  attachInterrupt(digitalPinToInterrupt(BTN_EN1), handleKnobInterrupt, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(BTN_EN2), handleKnobInterrupt, CHANGE);
 
   // Configure snooze block
   snoozeDigital.pinMode(BTN_ENC, INPUT_PULLUP, CHANGE);
@@ -57,12 +64,47 @@ void Panel::begin(SnoozeDigital& snoozeDigital) {
 }
 
 void Panel::update() {
-  updateKnobRotation();
   updateButton(&_knobButton, &_knobButtonEvent);
   updateButton(&_killButton, &_killButtonEvent);
 }
 
+void Panel::sendBuffer() {
+  const uint8_t* buffer = _display.getBufferPtr();
+  if (!_sentBufferValid) {
+    _display.sendBuffer();
+    memcpy(_sentBuffer, buffer, DISPLAY_BUFFER_SIZE);
+    _sentBufferValid = true;
+    return;
+  }
+
+  // Send the span of changed tiles in each row of tiles.
+  const uint32_t tileWidth = _display.getBufferTileWidth();
+  const uint32_t tileHeight = _display.getBufferTileHeight();
+  for (uint32_t ty = 0; ty < tileHeight; ty++) {
+    const size_t row = ty * tileWidth * TILE_SIZE;
+    int32_t first = -1;
+    int32_t last = -1;
+    for (uint32_t tx = 0; tx < tileWidth; tx++) {
+      const size_t offset = row + tx * TILE_SIZE;
+      if (memcmp(&buffer[offset], &_sentBuffer[offset], TILE_SIZE)) {
+        if (first < 0) first = tx;
+        last = tx;
+      }
+    }
+    if (first < 0) continue;
+
+    _display.updateDisplayArea(first, ty, last - first + 1, 1);
+    const size_t offset = row + first * TILE_SIZE;
+    memcpy(&_sentBuffer[offset], &buffer[offset], (last - first + 1) * TILE_SIZE);
+  }
+}
+
 void Panel::setColors(RGB display, RGB knob) {
+  // Writing the LEDs disables interrupts so avoid it when possible.
+  if (display == _displayColor && knob == _knobColor) return;
+
+  _displayColor = display;
+  _knobColor = knob;
   _leds.setPixelColor(0, display.r, display.g, display.b);
   _leds.setPixelColor(1, knob.r, knob.g, knob.b);
   _leds.setPixelColor(2, knob.r, knob.g, knob.b);
@@ -70,19 +112,30 @@ void Panel::setColors(RGB display, RGB knob) {
 }
 
 int32_t Panel::readKnobRotations() {
-  int32_t count = _knobRotations;
-  _knobRotations = 0;
+  int32_t count = 0;
+  int8_t direction;
+  while (_knobSteps.pop(&direction)) {
+    count += direction;
+  }
   return count;
 }
 
-void Panel::updateKnobRotation() {
-  switch (_knobEncoder.read()) {
+void Panel::handleKnobInterrupt() {
+  Panel* panel = _instance;
+  int8_t direction;
+  switch (panel->_knobEncoder.read()) {
     case DIR_CW:
-      _knobRotations++;
+      direction = 1;
       break;
     case DIR_CCW:
-      _knobRotations--;
+      direction = -1;
       break;
+    default:
+      return;
+  }
+  // Drops steps if the loop stalls for long.
+  if (!panel->_knobSteps.push(direction)) {
+    knobStepsDropped.add();
   }
 }
 
@@ -113,8 +166,12 @@ void Panel::playTone(uint32_t freq, uint32_t millis) {
   tone(BEEP, freq, millis);
 }
 
+bool Panel::isWakePin(int pin) {
+  return pin == BTN_ENC || pin == SW_KILL || pin == BTN_EN1 || pin == BTN_EN2;
+}
+
 bool Panel::canSleep() const {
-  return _knobRotations == 0
+  return _knobSteps.empty()
       && _knobButtonEvent == ButtonEvent::NONE
       && _killButtonEvent == ButtonEvent::NONE
       && digitalRead(BTN_ENC)
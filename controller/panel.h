@@ -84,29 +84,50 @@ public:
   // Gets the display's drawing interface.
   inline U8G2& gfx() { return _display; }
 
-  // Sets the panel's colors.
+  // Sends the tiles of the display buffer that changed since the last send.
+  void sendBuffer();
+
+  // Sets the panel's colors.  Does nothing if they haven't changed.
   void setColors(RGB display, RGB knob);
 
+  // Gets the panel's most recently set colors.
+  inline RGB displayColor() const { return _displayColor; }
+  inline RGB knobColor() const { return _knobColor; }
+
   // Plays a tone of finite duration to the buzzer.
   void playTone(uint32_t freq, uint32_t millis);
 
   // Returns true if it's ok to sleep now.
   bool canSleep() const;
 
+  // Returns true if the pin is one of the panel's inputs that wakes from sleep.
+  static bool isWakePin(int pin);
+
 private:
   Panel(const Panel&) = delete;
   Panel(Panel&&) = delete;  
   Panel& operator=(const Panel&) = delete;
   Panel& operator=(Panel&&) = delete;
 
-  void updateKnobRotation();
+  static void handleKnobInterrupt();
   static void updateButton(Switch* button, ButtonEvent* event);
 
+  static constexpr size_t DISPLAY_BUFFER_SIZE = 128 * 64 / 8;
+  static constexpr size_t TILE_SIZE = 8;
+
   U8G2_ST7567_OS12864_F_4W_HW_SPI _display;
+  uint8_t _sentBuffer[DISPLAY_BUFFER_SIZE];
+  bool _sentBufferValid = false;
   Adafruit_NeoPixel _leds;
+  RGB _displayColor{};
+  RGB _knobColor{};
+
+  static Panel* _instance;
 
+  // The encoder is read from a pin change interrupt so steps are not lost
+  // while the main loop is busy.  Each step is queued as its direction.
   MD_REncoder _knobEncoder;
-  int32_t _knobRotations;
+  EventQueue<int8_t, 32> _knobSteps;
 
   Switch _knobButton;
   ButtonEvent _knobButtonEvent;
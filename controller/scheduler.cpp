@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "scheduler.h"
+#include "utils.h"
+
+namespace {
+void waitForInterrupt() {
+#if defined(KINETISK)
+  asm volatile("wfi");
+#elif defined(SIMULATOR)
+  simulatorWaitForInterrupt();
+#endif
+}
+} // namespace
+
+void Scheduler::addTask(const char* name, TaskCallback callback) {
+  assert(_taskCount < MAX_TASKS);
+  _tasks[_taskCount++] = Task{name, callback, millis(), 0, 0, 0};
+}
+
+void Scheduler::run() {
+  for (unsigned i = 0; i < _taskCount; i++) {
+    Task& task = _tasks[i];
+    if (int32_t(millis() - task.deadline) < 0) continue;
+
+    uint32_t start = micros();
+    millis_t delay = task.callback();
+    uint32_t elapsed = micros() - start;
+    task.deadline = millis() + delay;
+    task.runs++;
+    task.busyMicros += elapsed;
+    if (elapsed > task.maxMicros) task.maxMicros = elapsed;
+  }
+}
+
+void Scheduler::idle() {
+  // The system tick interrupt wakes the processor every millisecond so keep
+  // waiting until the deadline has passed.  Other interrupts, such as from the
+  // knob, end the wait early so their events are handled promptly.
+  uint32_t start = micros();
+  millis_t startMillis = millis();
+  millis_t wait = timeUntilNextDeadline(startMillis);
+  while (millis() - startMillis < wait) {
+    millis_t before = millis();
+    waitForInterrupt();
+    if (millis() == before) break; // woken by something other than the tick
+  }
+  _idleMicros += micros() - start;
+}
+
+void Scheduler::wake() {
+  millis_t now = millis();
+  for (unsigned i = 0; i < _taskCount; i++) {
+    _tasks[i].deadline = now;
+  }
+}
+
+void Scheduler::printReportLine(Print& printer, unsigned line) const {
+  if (line == 0) {
+    printer.println("Task      Runs  Busy (ms)  Max (us)");
+  } else if (line <= _taskCount) {
+    const Task& task = _tasks[line - 1];
+    printer.print(task.name);
+    for (size_t n = strlen(task.name); n < 10; n++) printer.print(' ');
+    printer.print(task.runs);
+    printer.print("  ");
+    printer.print(uint32_t(task.busyMicros / 1000));
+    printer.print("  ");
+    printer.println(task.maxMicros);
+  } else {
+    printer.print("Idle ");
+    printer.print(uint32_t(_idleMicros / 1000));
+    printer.print(" ms of ");
+    printer.print(millis() - _statsStartTime);
+    printer.println(" ms awake");
+  }
+}
+
+void Scheduler::resetStats() {
+  for (unsigned i = 0; i < _taskCount; i++) {
+    _tasks[i].runs = 0;
+    _tasks[i].busyMicros = 0;
+    _tasks[i].maxMicros = 0;
+  }
+  _idleMicros = 0;
+  _statsStartTime = millis();
+}
+
+millis_t Scheduler::timeUntilNextDeadline(millis_t now) const {
+  millis_t wait = UINT32_MAX;
+  for (unsigned i = 0; i < _taskCount; i++) {
+    int32_t remaining = int32_t(_tasks[i].deadline - now);
+    if (remaining <= 0) return 0;
+    wait = std::min(wait, millis_t(remaining));
+  }
+  return wait;
+}
@@ -0,0 +1,66 @@
+/*
+ * Cooperative task scheduler.
+ *
+ * Each task runs to completion and returns how long to wait before running it
+ * again.  Between tasks the processor idles until the earliest deadline or the
+ * next interrupt instead of spinning.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Print.h>
+
+using millis_t = uint32_t;
+
+class Scheduler {
+public:
+  // Runs the task and returns the number of milliseconds until it should run again.
+  using TaskCallback = millis_t (*)();
+
+  constexpr static unsigned MAX_TASKS = 8;
+
+  Scheduler() {}
+  ~Scheduler() = default;
+
+  // Adds a task that will first run on the next call to run().
+  void addTask(const char* name, TaskCallback callback);
+
+  // Runs all tasks whose deadlines have passed.
+  void run();
+
+  // Idles the processor until the earliest deadline.  Returns early if
+  // an interrupt occurs that might need attention sooner.
+  void idle();
+
+  // Makes all tasks due so they run on the next call to run(), such as after waking.
+  void wake();
+
+  // Prints the time spent running each task since the last reset
+  // a line at a time, a heading, a line per task, and the idle time.
+  inline unsigned reportLineCount() const { return _taskCount + 2; }
+  void printReportLine(Print& printer, unsigned line) const;
+  void resetStats();
+
+private:
+  Scheduler(const Scheduler&) = delete;
+  Scheduler(Scheduler&&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+  Scheduler& operator=(Scheduler&&) = delete;
+
+  struct Task {
+    const char* name;
+    TaskCallback callback;
+    millis_t deadline;
+    uint32_t runs;
+    uint64_t busyMicros;
+    uint32_t maxMicros;
+  };
+
+  millis_t timeUntilNextDeadline(millis_t now) const;
+
+  Task _tasks[MAX_TASKS];
+  unsigned _taskCount = 0;
+  uint64_t _idleMicros = 0;
+  uint32_t _statsStartTime = 0;
+};
@@ -0,0 +1,90 @@
+#include "settings.h"
+
+uint8_t Settings::_shadow[Settings::SIZE];
+uint32_t Settings::_dirty[Settings::SIZE / 32];
+size_t Settings::_dirtyCount = 0;
+size_t Settings::_commitWord = 0;
+uint32_t Settings::_lastWriteTime = 0;
+bool Settings::_commitRequested = false;
+
+namespace {
+constexpr eeprom_addr_t SCHEMA_ADDR = Settings::SIZE - 4;
+constexpr uint32_t SCHEMA_MAGIC = 0xAB5C155A;
+} // namespace
+
+void Settings::begin(uint8_t schemaVersion, InitCallback init, MigrateCallback migrate) {
+  for (size_t i = 0; i < SIZE; i++) {
+    _shadow[i] = EEPROM.read(i);
+  }
+
+  const uint32_t version = read<uint32_t>(SCHEMA_ADDR) ^ SCHEMA_MAGIC;
+  if (version == schemaVersion) return;
+
+  // Commit each step as it completes so that an interrupted upgrade
+  // resumes from the last completed step.
+  if (version > 0 && version < schemaVersion) {
+    uint8_t current = version;
+    while (current < schemaVersion && migrate(current)) {
+      current++;
+      write<uint32_t>(SCHEMA_ADDR, SCHEMA_MAGIC ^ current);
+      flush();
+    }
+    if (current == schemaVersion) return;
+  }
+
+  clear(0, SIZE);
+  init();
+  write<uint32_t>(SCHEMA_ADDR, SCHEMA_MAGIC ^ schemaVersion);
+  flush();
+}
+
+void Settings::eraseAndReboot() {
+  write<uint32_t>(SCHEMA_ADDR, 0);
+  flush();
+  _reboot_Teensyduino_();
+}
+
+void Settings::update() {
+  if (!_dirtyCount) return;
+  if (!_commitRequested && millis() - _lastWriteTime < QUIET_PERIOD) return;
+
+  commitBytes(MAX_COMMIT_LENGTH);
+  if (!_dirtyCount) {
+    _commitRequested = false;
+  }
+}
+
+void Settings::commit() {
+  if (_dirtyCount) {
+    _commitRequested = true;
+  }
+}
+
+void Settings::flush() {
+  commitBytes(SIZE);
+  _commitRequested = false;
+}
+
+void Settings::commitBytes(size_t maxLength) {
+  // Resume scanning where the previous commit left off.
+  constexpr size_t WORDS = SIZE / 32;
+  size_t length = 0;
+  size_t scanned = 0;
+  while (_dirtyCount && length < maxLength && scanned <= WORDS) {
+    uint32_t& word = _dirty[_commitWord];
+    if (!word) {
+      _commitWord = (_commitWord + 1) % WORDS;
+      scanned++;
+      continue;
+    }
+
+    // The value may have been changed back since it was marked dirty so
+    // let the EEPROM skip the write if it already matches.
+    const unsigned bit = __builtin_ctz(word);
+    const eeprom_addr_t addr = _commitWord * 32 + bit;
+    EEPROM.update(addr, _shadow[addr]);
+    word &= ~(1UL << bit);
+    _dirtyCount--;
+    length++;
+  }
+}
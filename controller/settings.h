@@ -1,5 +1,10 @@
 /*
  * Stores typed values in EEPROM with a checksum.
+ *
+ * Keeps a shadow copy of the EEPROM in RAM so that reading settings
+ * is cheap.  Writes update the shadow immediately and are committed to
+ * the EEPROM a few bytes at a time once the settings stop changing
+ * to keep the loop responsive and reduce flash wear.
  */
 
 #pragma once
@@ -10,7 +15,8 @@
 using eeprom_addr_t = uint16_t;
 
 // Initializes the EEPROM for settings.
-// Erases all settings if the schema has changed.
+// Upgrades the settings one version at a time if the schema has changed,
+// or erases all settings if there is no upgrade path.
 class Settings {
 public:
   Settings() {}
@@ -18,26 +24,35 @@ public:
 
   using InitCallback = void (*)();
 
-  static void begin(uint8_t schemaVersion, InitCallback init) {
-    const uint32_t expected = 0xAB5C155A ^ schemaVersion;
-    if (read<uint32_t>(EEPROM.length() - 4) != expected) {
-      clear(0, EEPROM.length());
-      init();
-      write<uint32_t>(EEPROM.length() - 4, expected);
-    }
-  }
+  // Upgrades the settings from the given schema version to the next one
+  // by moving, adding, or defaulting only the affected records.
+  // Returns false if there is no upgrade path.
+  using MigrateCallback = bool (*)(uint8_t fromVersion);
 
-  static void eraseAndReboot() {
-    write<uint32_t>(EEPROM.length() - 4, 0);
-    _reboot_Teensyduino_();
-  }
+  static constexpr size_t SIZE = E2END + 1;
+
+  static void begin(uint8_t schemaVersion, InitCallback init, MigrateCallback migrate);
+
+  static void eraseAndReboot();
+
+  // Commits some of the pending writes if they are due.
+  // Call once per loop.
+  static void update();
+
+  // Requests that pending writes be committed soon, such as when the user
+  // has finished editing a value, instead of waiting for a quiet period.
+  static void commit();
+
+  // Commits all pending writes now.
+  static void flush();
+
+  // Returns true if there are writes that have not been committed.
+  static bool isDirty() { return _dirtyCount != 0; }
 
   template <typename T>
   static T read(eeprom_addr_t addr) {
     T value;
-    uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
-    for (size_t i = 0; i < sizeof(T); i++)
-      bytes[i] = EEPROM[addr + i];
+    memcpy(&value, &_shadow[addr], sizeof(T));
     return value;
   }
 
@@ -45,16 +60,45 @@ public:
   static void write(eeprom_addr_t addr, T value) {
     const uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
     for (size_t i = 0; i < sizeof(T); i++)
-      EEPROM[addr + i].update(bytes[i]);
+      writeByte(addr + i, bytes[i]);
   }
 
   static void clear(eeprom_addr_t addr, size_t length) {
     for (size_t i = 0; i < length; i++) {
-      EEPROM[addr + i].update(0);
+      writeByte(addr + i, 0);
     }
   }
 
 private:
+  // Wait this long after the last write before committing.
+  static constexpr uint32_t QUIET_PERIOD = 2000;
+
+  // Maximum number of bytes to commit per update.
+  static constexpr size_t MAX_COMMIT_LENGTH = 4;
+
+  // Marks the byte dirty if the value changes.
+  static void writeByte(eeprom_addr_t addr, uint8_t value) {
+    if (_shadow[addr] == value) return;
+    _shadow[addr] = value;
+    _lastWriteTime = millis();
+
+    uint32_t& word = _dirty[addr / 32];
+    const uint32_t bit = 1UL << (addr % 32);
+    if (!(word & bit)) {
+      word |= bit;
+      _dirtyCount++;
+    }
+  }
+
+  static void commitBytes(size_t maxLength);
+
+  static uint8_t _shadow[SIZE];
+  static uint32_t _dirty[SIZE / 32];
+  static size_t _dirtyCount;
+  static size_t _commitWord;
+  static uint32_t _lastWriteTime;
+  static bool _commitRequested;
+
   Settings(const Settings&) = delete;
   Settings(Settings&&) = delete;  
   Settings& operator=(const Settings&) = delete;
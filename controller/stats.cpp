@@ -0,0 +1,91 @@
+#include "stats.h"
+
+Stat* Stat::_first = nullptr;
+
+Stat::Stat(const char* name) : _name(name), _next(_first) {
+  _first = this;
+}
+
+unsigned Stat::count() {
+  unsigned count = 0;
+  for (Stat* stat = _first; stat; stat = stat->_next) count++;
+  return count;
+}
+
+void Stat::resetAll() {
+  for (Stat* stat = _first; stat; stat = stat->_next) {
+    stat->reset();
+  }
+}
+
+void Counter::printSummary(Print& printer) const {
+  printer.print(_value);
+}
+
+void Counter::printLine(Print& printer, unsigned line) const {
+  printer.print(name());
+  printer.print(": ");
+  printer.println(_value);
+}
+
+void Histogram::add(uint32_t value) {
+  unsigned bucket = value ? 32 - __builtin_clz(value) : 0;
+  _buckets[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+  _count++;
+  _sum += value;
+  if (value > _max) _max = value;
+}
+
+void Histogram::printSummary(Print& printer) const {
+  printer.print(mean());
+  printer.print(" / ");
+  printer.print(_max);
+}
+
+unsigned Histogram::lineCount() const {
+  unsigned lines = 2;
+  for (unsigned i = 0; i < BUCKETS; i++) {
+    if (_buckets[i]) lines++;
+  }
+  return lines;
+}
+
+void Histogram::printLine(Print& printer, unsigned line) const {
+  if (line == 0) {
+    printer.print(name());
+    printer.print(": n=");
+    printer.println(_count);
+    return;
+  }
+  if (line == 1) {
+    printer.print("  mean=");
+    printer.print(mean());
+    printer.print(" max=");
+    printer.println(_max);
+    return;
+  }
+
+  // Each bucket holds values less than the power of two shown.
+  // Only the buckets that have values are printed.
+  unsigned bucket = 0;
+  for (unsigned skip = line - 2; bucket < BUCKETS; bucket++) {
+    if (_buckets[bucket] && !skip--) break;
+  }
+  if (bucket == BUCKETS) return;
+
+  printer.print("  <");
+  if (bucket == BUCKETS - 1) {
+    printer.print("inf");
+  } else {
+    printer.print(1UL << bucket);
+  }
+  printer.print(": ");
+  printer.println(_buckets[bucket]);
+}
+
+void Histogram::reset() {
+  for (unsigned i = 0; i < BUCKETS; i++) _buckets[i] = 0;
+  _count = 0;
+  _max = 0;
+  _sum = 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Runtime instrumentation.
+ *
+ * Counters and histograms register themselves on construction so they can be
+ * listed and printed without a central table.  Recording a value costs a few
+ * instructions so they can be used on hot paths.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Print.h>
+
+class Stat {
+public:
+  virtual ~Stat() = default;
+
+  inline const char* name() const { return _name; }
+
+  // Prints a one line summary of the value.
+  virtual void printSummary(Print& printer) const = 0;
+
+  // Prints the full details of the value a line at a time so that streaming
+  // output never has to hold more than one line.  Lines are short enough
+  // to stream in one console chunk.
+  virtual unsigned lineCount() const = 0;
+  virtual void printLine(Print& printer, unsigned line) const = 0;
+
+  virtual void reset() = 0;
+
+  // Iterates over all stats.
+  static inline Stat* first() { return _first; }
+  inline Stat* next() const { return _next; }
+  static unsigned count();
+
+  // Resets all stats.
+  static void resetAll();
+
+protected:
+  explicit Stat(const char* name);
+
+private:
+  Stat(const Stat&) = delete;
+  Stat(Stat&&) = delete;
+  Stat& operator=(const Stat&) = delete;
+  Stat& operator=(Stat&&) = delete;
+
+  static Stat* _first;
+  const char* const _name;
+  Stat* const _next;
+};
+
+// Counts events or accumulates a total.
+class Counter : public Stat {
+public:
+  explicit Counter(const char* name) : Stat(name) {}
+
+  inline void add(uint32_t amount = 1) { _value += amount; }
+  inline uint32_t value() const { return _value; }
+
+  void printSummary(Print& printer) const override;
+  unsigned lineCount() const override { return 1; }
+  void printLine(Print& printer, unsigned line) const override;
+  void reset() override { _value = 0; }
+
+private:
+  uint32_t _value = 0;
+};
+
+// Records the distribution of values in buckets by powers of two.
+class Histogram : public Stat {
+public:
+  constexpr static unsigned BUCKETS = 20; // the last bucket holds everything larger
+
+  explicit Histogram(const char* name) : Stat(name) {}
+
+  void add(uint32_t value);
+  inline uint32_t count() const { return _count; }
+  inline uint32_t max() const { return _max; }
+  inline uint32_t mean() const { return _count ? uint32_t(_sum / _count) : 0; }
+
+  void printSummary(Print& printer) const override;
+  unsigned lineCount() const override;
+  void printLine(Print& printer, unsigned line) const override;
+  void reset() override;
+
+private:
+  uint32_t _buckets[BUCKETS] = {};
+  uint32_t _count = 0;
+  uint32_t _max = 0;
+  uint64_t _sum = 0;
+};
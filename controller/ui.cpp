@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <utility>
 
+#include "stats.h"
 #include "ui.h"
 #include "utils.h"
 
@@ -8,8 +9,16 @@ namespace {
 constexpr RGB DEFAULT_DISPLAY_COLOR = RGB{188,0,166};
 constexpr RGB DEFAULT_KNOB_COLOR = RGB{40,40,40};
 
-constexpr millis_t POLL_INTERVAL = 20;
-constexpr millis_t DRAW_INTERVAL = 20;
+// Poll and draw quickly while the user is interacting with the panel then
+// back off once input has stopped for a little while.
+constexpr millis_t ACTIVE_POLL_INTERVAL = 20;
+constexpr millis_t ACTIVE_DRAW_INTERVAL = 20;
+constexpr millis_t IDLE_DRAW_INTERVAL = 100;
+constexpr millis_t ACTIVE_HOLD_TIME = 1500;
+
+Histogram updateIterations("UI iterations");
+Histogram drawMicros("UI draw us");
+Histogram flushMicros("UI flush us");
 } // namespace
 
 InputEvent Binding::readInputEvent() {
@@ -50,7 +59,9 @@ void Stage::begin(std::unique_ptr<Scene> scene) {
 }
 
 void Stage::update() {
-  while (updateOnce());
+  uint32_t iterations = 1;
+  while (updateOnce()) iterations++;
+  updateIterations.add(iterations);
 }
 
 bool Stage::updateOnce() {
@@ -132,7 +143,7 @@ bool Stage::updateOnce() {
 
   // Handle polling for changes (may wake)
   _context._frameTime = millis();
-  if (_needPoll || _context._frameTime - _lastPollTime >= POLL_INTERVAL) {
+  if (_needPoll || _context._frameTime - _lastPollTime >= pollInterval()) {
     _needPoll = false;
     _lastPollTime = _context._frameTime;
     topScene().poll(_context);
@@ -152,11 +163,16 @@ bool Stage::updateOnce() {
   }
 
   // Handle drawing
-  if (_context._requestedDraw && _context._frameTime - _lastDrawTime >= DRAW_INTERVAL) {
+  if (_context._requestedDraw && _context._frameTime - _lastDrawTime >= drawInterval()) {
     _context._requestedDraw = false;
+    _lastDrawTime = _context._frameTime;
+    uint32_t start = micros();
     beginDraw();
     topScene().draw(_context, _canvas);
+    uint32_t drawn = micros();
     endDraw();
+    drawMicros.add(drawn - start);
+    flushMicros.add(micros() - drawn);
     return true;
   }
 
@@ -180,7 +196,7 @@ void Stage::beginDraw() {
 }
 
 void Stage::endDraw() {
-  _canvas.gfx().sendBuffer();
+  _binding->sendBuffer();
   _canvas.applyColors();
 }
 
@@ -188,6 +204,19 @@ void Stage::activity() {
   _lastActivityTime = millis();
 }
 
+bool Stage::isActive() const {
+  return !_asleep && _context._frameTime - _lastActivityTime < ACTIVE_HOLD_TIME;
+}
+
+millis_t Stage::pollInterval() {
+  millis_t interval = topScene().pollInterval();
+  return isActive() ? std::min(interval, ACTIVE_POLL_INTERVAL) : interval;
+}
+
+millis_t Stage::drawInterval() const {
+  return isActive() ? ACTIVE_DRAW_INTERVAL : IDLE_DRAW_INTERVAL;
+}
+
 void Stage::pushState(std::unique_ptr<Scene> scene) {
   assert(_stateIndex < MAX_STATE_STACK_DEPTH);
   _stateStack[++_stateIndex].scene = std::move(scene);
@@ -211,6 +240,7 @@ bool Menu::input(Context& context, const InputEvent& event) {
     case InputType::SINGLE_CLICK:
       if (_editing) {
         _editing = false;
+        Settings::commit();
       } else {
         _editing = _items[_activeIndex]->click(context);
       }
@@ -222,7 +252,7 @@ bool Menu::input(Context& context, const InputEvent& event) {
         context.requestDraw();
       } else {
         size_t newIndex = std::min(_items.size() - 1,
-            size_t(std::max(0L, int32_t(_activeIndex) + event.value)));
+            size_t(std::max<int32_t>(0, int32_t(_activeIndex) + event.value)));
         if (_activeIndex != newIndex) {
           _activeIndex = newIndex;
           context.requestDraw();
@@ -233,6 +263,7 @@ bool Menu::input(Context& context, const InputEvent& event) {
     case InputType::LONG_PRESS:
       if (_editing) {
         _editing = false;
+        Settings::commit();
         context.requestDraw();
         return true;
       }
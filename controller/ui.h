@@ -25,6 +25,8 @@ constexpr uint32_t LAYOUT_VALUE_MARGIN = 3;
 
 constexpr const uint8_t *DEFAULT_FONT = u8g2_font_miranda_nbp_tr;
 constexpr const uint8_t *TITLE_FONT = u8g2_font_prospero_bold_nbp_tr;
+
+constexpr millis_t DEFAULT_POLL_INTERVAL = 100;
 } // namespace
 
 enum class InputType {
@@ -55,6 +57,11 @@ public:
   // Gets the display's drawing interface.
   inline U8G2& gfx() { return _panel->gfx(); }
 
+  // Sends the changed parts of the display buffer to the display.
+  inline void sendBuffer() {
+    _panel->sendBuffer();
+  }
+
   // Sets the panel's colors.
   inline void setColors(RGB display, RGB knob) {
     _panel->setColors(display, knob);
@@ -158,6 +165,9 @@ public:
 
   bool canSleep() const;
 
+  // Returns true if the display has been put to sleep.
+  inline bool isAsleep() const { return _asleep; }
+
 private:
   struct State {
     std::unique_ptr<Scene> scene;
@@ -174,6 +184,9 @@ private:
   void beginDraw();
   void endDraw();
   void activity();
+  bool isActive() const;
+  millis_t pollInterval();
+  millis_t drawInterval() const;
 
   static constexpr ssize_t MAX_STATE_STACK_DEPTH = 5;
 
@@ -209,6 +222,10 @@ public:
   // Called periodically to check for changes and make requests on the context.
   virtual void poll(Context& context) {}
 
+  // Returns how often the scene needs to be polled while there is no input.
+  // The stage polls more often than this for a little while after input.
+  virtual millis_t pollInterval() const { return DEFAULT_POLL_INTERVAL; }
+
   // Called to draw the contents of the scene when not asleep.
   virtual void draw(Context& context, Canvas& canvas) {}
 
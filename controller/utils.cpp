@@ -8,6 +8,119 @@
 
 namespace {
 constexpr float M_PI_180 = M_PI / 180;
+
+constexpr unsigned TINT_COUNT = TINT_MAX - TINT_MIN + 1;
+constexpr unsigned TONE_COUNT = TONE_MAX - TONE_MIN + 1;
+constexpr unsigned BRIGHTNESS_COUNT = BRIGHTNESS_MAX - BRIGHTNESS_MIN + 1;
+
+// Rounds half away from zero like roundf() for values from 0 to 255.
+constexpr uint8_t roundToUint8(float t) {
+  const uint8_t i = uint8_t(t);
+  return t - i >= 0.5f ? i + 1 : i;
+}
+
+constexpr uint8_t scaleAndClampRgb(float t, float scale) {
+  t *= scale;
+  if (t <= 0.1f) return 0;
+  if (t >= 255.f) return 255;
+  if (t <= 1.f) return 1;
+  return roundToUint8(t);
+}
+
+// Square root by Newton's method for use in constant expressions.
+constexpr double constexprSqrt(double x) {
+  if (x <= 0) return 0;
+  double r = x < 1 ? 1 : x;
+  for (int i = 0; i < 64; i++) {
+    const double next = (r + x / r) * 0.5;
+    if (next >= r) break;
+    r = next;
+  }
+  return r;
+}
+
+// Same as powf(brightness * 0.1f, 2.5f).
+// Makes scale non-linear to expand dynamic range at low end.
+constexpr float stripBrightnessScale(brightness_t brightness) {
+  const double x = brightness * 0.1f;
+  return float(x * x * constexprSqrt(x));
+}
+
+constexpr RGB computeKnobColor(tint_t tint, tone_t tone, brightness_t brightness) {
+  const float scale = brightness * 0.1f;
+  if (tint == TINT_WHITE) {
+    return RGB{
+      scaleAndClampRgb(253.f, scale),
+      scaleAndClampRgb(244.f, scale),
+      scaleAndClampRgb(220.f, scale)
+    };
+  } else {
+    const uint8_t pos = uint32_t(tint) * 255 / 36;
+    const RGB color = RGB::colorWheel(pos);
+    const float alpha = tone * 0.1f;
+    const float beta = 1.f - alpha;
+    return RGB{
+      scaleAndClampRgb(color.r * alpha + 255.f * beta, scale),
+      scaleAndClampRgb(color.g * alpha + 255.f * beta, scale),
+      scaleAndClampRgb(color.b * alpha + 255.f * beta, scale)
+    };
+  }
+}
+
+constexpr RGBW computeStripColor(tint_t tint, tone_t tone, brightness_t brightness) {
+  const float scale = stripBrightnessScale(brightness);
+  if (tint == TINT_WHITE) {
+    return RGBW{0, 0, 0, scaleAndClampRgb(210.f, scale)};
+  } else {
+    const uint8_t pos = uint32_t(tint) * 255 / 36;
+    const RGB color = RGB::colorWheel(pos);
+    const float alpha = 0.4f + tone * 0.06f;
+    const float beta = 0.6f - tone * 0.06f;
+    return RGBW{
+      scaleAndClampRgb(color.r * alpha, scale),
+      scaleAndClampRgb(color.g * alpha, scale),
+      scaleAndClampRgb(color.b * alpha, scale),
+      scaleAndClampRgb(255.f * beta, scale),
+    };
+  }
+}
+
+// Precomputes the colors for every tint, tone, and brightness at compile
+// time so that they can be looked up from flash without any float math.
+// Both tables together take about 28 KB of flash.
+template <typename Color, Color (*compute)(tint_t, tone_t, brightness_t)>
+class ColorTable {
+public:
+  constexpr ColorTable() : _colors{} {
+    for (unsigned tint = 0; tint < TINT_COUNT; tint++) {
+      for (unsigned tone = 0; tone < TONE_COUNT; tone++) {
+        for (unsigned brightness = 0; brightness < BRIGHTNESS_COUNT; brightness++) {
+          _colors[(tint * TONE_COUNT + tone) * BRIGHTNESS_COUNT + brightness] =
+              compute(tint + TINT_MIN, tone + TONE_MIN, brightness + BRIGHTNESS_MIN);
+        }
+      }
+    }
+  }
+
+  // Clamps arguments that are out of range, such as when reading
+  // uninitialized settings, so that it never falls back to float math.
+  Color get(tint_t tint, tone_t tone, brightness_t brightness) const {
+    const unsigned t = clampIndex(tint, TINT_MIN, TINT_MAX);
+    const unsigned s = clampIndex(tone, TONE_MIN, TONE_MAX);
+    const unsigned b = clampIndex(brightness, BRIGHTNESS_MIN, BRIGHTNESS_MAX);
+    return _colors[(t * TONE_COUNT + s) * BRIGHTNESS_COUNT + b];
+  }
+
+private:
+  static unsigned clampIndex(unsigned value, unsigned min, unsigned max) {
+    return (value < min ? min : value > max ? max : value) - min;
+  }
+
+  Color _colors[TINT_COUNT * TONE_COUNT * BRIGHTNESS_COUNT];
+};
+
+constexpr ColorTable<RGB, computeKnobColor> KNOB_COLORS;
+constexpr ColorTable<RGBW, computeStripColor> STRIP_COLORS;
 } // namespace
 
 void printDateAndTime(Print& printer, time_t time) {
@@ -28,29 +141,32 @@ void printDateAndTime(Print& printer, time_t time) {
   printer.print(te.Second);
 }
 
-uint8_t scaleAndClampRgb(float t, float scale) {
-  t *= scale;
-  if (t <= 0.1f) return 0;
-  if (t >= 255.f) return 255;
-  if (t <= 1.f) return 1;
-  return uint8_t(roundf(t));
+namespace {
+// Integer square root, rounded to nearest.
+uint32_t isqrt(uint32_t n) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > n) bit >>= 2;
+  while (bit) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return n > root ? root + 1 : root;
 }
+} // namespace
 
-RGB RGB::colorWheel(uint8_t pos) {
-  pos = 255 - pos;
-  if (pos < 85)
-    return RGB{uint8_t(255 - pos * 3), 0, uint8_t(pos * 3)};
-  if (pos < 170)
-    return RGB{0, uint8_t((pos - 85) * 3), uint8_t(255 - (pos - 85) * 3)};
-  return RGB{uint8_t((pos - 170) * 3), uint8_t(255 - (pos - 170) * 3), 0};
-}
+fract16_t gamma25(fract16_t x) {
+  if (x >= FRACT16_ONE) return FRACT16_ONE;
 
-RGB RGB::operator*(float scale) const {
-  return RGB{
-    scaleAndClampRgb(r, scale),
-    scaleAndClampRgb(g, scale),
-    scaleAndClampRgb(b, scale)
-  };
+  // x^2.5 = x^2 * sqrt(x), each step fits in 32 bits because x < 1
+  const uint32_t square = (x * x + FRACT16_ONE / 2) >> 16;
+  const uint32_t root = isqrt(x << 16);
+  return (square * root + FRACT16_ONE / 2) >> 16;
 }
 
 float mapLabToXyzComponent(float t) {
@@ -135,38 +251,22 @@ void printBrightness(Print& printer, brightness_t brightness) {
 }
 
 RGB makeKnobColor(tint_t tint, tone_t tone, brightness_t brightness) {
-  const float scale = brightness * 0.1f;
 #if USE_LCH_COLOR
+  const float scale = brightness * 0.1f;
   if (tint == TINT_WHITE) {
     return LCH{100.f, 0.0f, 0.0f}.toRGB() * scale;
   } else {
     return LCH{60.f, 70.f, (tint - 1) * 10.f}.toRGB() * scale;
   }
 #else
-  if (tint == TINT_WHITE) {
-    return RGB{
-      scaleAndClampRgb(253.f, scale),
-      scaleAndClampRgb(244.f, scale),
-      scaleAndClampRgb(220.f, scale)
-    };
-  } else {
-    const uint8_t pos = uint32_t(tint) * 255 / 36;
-    const RGB color = RGB::colorWheel(pos);
-    const float alpha = tone * 0.1f;
-    const float beta = 1.f - alpha;
-    return RGB{
-      scaleAndClampRgb(color.r * alpha + 255.f * beta, scale),
-      scaleAndClampRgb(color.g * alpha + 255.f * beta, scale),
-      scaleAndClampRgb(color.b * alpha + 255.f * beta, scale)
-    };
-  }
+  return KNOB_COLORS.get(tint, tone, brightness);
 #endif
 }
 
 RGBW makeStripColor(tint_t tint, tone_t tone, brightness_t brightness) {
+#if USE_LCH_COLOR
   // make scale non-linear to expand dynamic range at low end
   const float scale = powf(brightness * 0.1f, 2.5f);
-#if USE_LCH_COLOR
   if (tint == TINT_WHITE) {
     return RGBW{0, 0, 0, 255} * scale;
   } else {
@@ -174,19 +274,6 @@ RGBW makeStripColor(tint_t tint, tone_t tone, brightness_t brightness) {
     return RGBW{rgb.r, rgb.g, rgb.b, 180} * scale;
   }
 #else
-  if (tint == TINT_WHITE) {
-    return RGBW{0, 0, 0, scaleAndClampRgb(210.f, scale)};
-  } else {
-    const uint8_t pos = uint32_t(tint) * 255 / 36;
-    const RGB color = RGB::colorWheel(pos);
-    const float alpha = 0.4f + tone * 0.06f;
-    const float beta = 0.6f - tone * 0.06f;
-    return RGBW{
-      scaleAndClampRgb(color.r * alpha, scale),
-      scaleAndClampRgb(color.g * alpha, scale),
-      scaleAndClampRgb(color.b * alpha, scale),
-      scaleAndClampRgb(255.f * beta, scale),
-    };
-  }
+  return STRIP_COLORS.get(tint, tone, brightness);
 #endif
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <Print.h>
 #include <TimeLib.h>
 
@@ -12,13 +14,50 @@ inline void assert(bool condition) {
 
 void printDateAndTime(Print& printer, time_t time);
 
+// Unsigned fixed-point scale factor with 8 fractional bits (Q8.8).
+using scale8_t = uint16_t;
+constexpr scale8_t SCALE8_ONE = 1 << 8;
+
+// Converts a scale factor to fixed-point, rounding to nearest and saturating.
+constexpr scale8_t toScale8(float scale) {
+  return scale <= 0.f ? 0 : scale >= 65535.f / SCALE8_ONE ? 0xffff
+      : scale8_t(scale * SCALE8_ONE + 0.5f);
+}
+
+// Unsigned fixed-point fraction with 16 fractional bits (Q16.16).
+using fract16_t = uint32_t;
+constexpr fract16_t FRACT16_ONE = 1 << 16;
+
+// Applies the same non-linear 2.5 power curve as the strip brightness
+// to a fraction from 0 to 1 using integer math only.
+fract16_t gamma25(fract16_t x);
+
+// Scales an 8-bit color component, rounding to nearest and saturating.
+// Like the float version, dim results round up to 1 instead of turning off.
+inline uint8_t scaleAndClamp8(uint8_t value, scale8_t scale) {
+  const uint32_t t = uint32_t(value) * scale;
+  if (t <= SCALE8_ONE / 10) return 0;
+  if (t >= 255U * SCALE8_ONE) return 255;
+  if (t <= SCALE8_ONE) return 1;
+  return uint8_t((t + SCALE8_ONE / 2) >> 8);
+}
+
+// Interpolates between two 8-bit color components, from a when t is 0
+// to b when t is SCALE8_ONE.
+inline uint8_t lerp8(uint8_t a, uint8_t b, scale8_t t) {
+  return uint8_t(a + (((int32_t(b) - a) * int32_t(t) + SCALE8_ONE / 2) >> 8));
+}
+
 // Linear RGB color, 8-bit integer components. 
 struct RGB {
   uint8_t r, g, b;
 
-  static RGB colorWheel(uint8_t pos);
+  static constexpr RGB colorWheel(uint8_t pos);
+
+  static RGB lerp(const RGB& a, const RGB& b, scale8_t t);
 
   RGB operator*(float scale) const;
+  RGB scaled(scale8_t scale) const;
 
   bool operator==(const RGB& other) const {
     return r == other.r && g == other.g && b == other.b;
@@ -27,11 +66,35 @@ struct RGB {
   bool operator!=(const RGB& other) const { return !(*this == other); }
 };
 
+constexpr RGB RGB::colorWheel(uint8_t pos) {
+  pos = 255 - pos;
+  if (pos < 85)
+    return RGB{uint8_t(255 - pos * 3), 0, uint8_t(pos * 3)};
+  if (pos < 170)
+    return RGB{0, uint8_t((pos - 85) * 3), uint8_t(255 - (pos - 85) * 3)};
+  return RGB{uint8_t((pos - 170) * 3), uint8_t(255 - (pos - 170) * 3), 0};
+}
+
+inline RGB RGB::lerp(const RGB& a, const RGB& b, scale8_t t) {
+  return RGB{lerp8(a.r, b.r, t), lerp8(a.g, b.g, t), lerp8(a.b, b.b, t)};
+}
+
+inline RGB RGB::operator*(float scale) const {
+  return scaled(toScale8(scale));
+}
+
+inline RGB RGB::scaled(scale8_t scale) const {
+  return RGB{scaleAndClamp8(r, scale), scaleAndClamp8(g, scale), scaleAndClamp8(b, scale)};
+}
+
 // Linear RGBW color, 8-bit integer omponents.
 struct RGBW {
   uint8_t r, g, b, w;
 
   static RGBW fromRGB(const RGB& other);
+  static RGBW lerp(const RGBW& a, const RGBW& b, scale8_t t);
+
+  RGBW scaled(scale8_t scale) const;
 
   bool operator==(const RGBW& other) const {
     return r == other.r && g == other.g && b == other.b && w == other.w;
@@ -44,6 +107,15 @@ inline RGBW RGBW::fromRGB(const RGB& other) {
   return RGBW{other.r, other.g, other.b, 0};
 }
 
+inline RGBW RGBW::lerp(const RGBW& a, const RGBW& b, scale8_t t) {
+  return RGBW{lerp8(a.r, b.r, t), lerp8(a.g, b.g, t), lerp8(a.b, b.b, t), lerp8(a.w, b.w, t)};
+}
+
+inline RGBW RGBW::scaled(scale8_t scale) const {
+  return RGBW{scaleAndClamp8(r, scale), scaleAndClamp8(g, scale),
+      scaleAndClamp8(b, scale), scaleAndClamp8(w, scale)};
+}
+
 // Lightness, Chroma, Hue representation
 // More perceptually uniform than HSV though not all colors can be represented
 // in RGB space.  See https://en.wikipedia.org/wiki/HCL_color_space.
@@ -87,6 +159,53 @@ RGB makeKnobColor(tint_t tint, tone_t tone, brightness_t brightness);
 // Generates a color suitable for display on an LED strip.
 RGBW makeStripColor(tint_t tint, tone_t tone, brightness_t brightness);
 
+// Fixed-capacity queue for passing events from an interrupt handler to the
+// main loop without disabling interrupts.  Supports one producer and one consumer.
+template <typename T, size_t capacity>
+class EventQueue {
+  static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0,
+      "capacity must be a power of two");
+
+public:
+  EventQueue() {}
+  ~EventQueue() = default;
+
+  // Adds an event to the queue.  Returns false if the queue is full.
+  // Only call from the producer.
+  bool push(const T& event) {
+    uint32_t head = _head;
+    if (head - _tail == capacity) return false;
+    _events[head & (capacity - 1)] = event;
+    std::atomic_signal_fence(std::memory_order_release);
+    _head = head + 1;
+    return true;
+  }
+
+  // Removes the oldest event from the queue.  Returns false if the queue is empty.
+  // Only call from the consumer.
+  bool pop(T* event) {
+    uint32_t tail = _tail;
+    if (_head == tail) return false;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    *event = _events[tail & (capacity - 1)];
+    std::atomic_signal_fence(std::memory_order_release);
+    _tail = tail + 1;
+    return true;
+  }
+
+  inline bool empty() const { return _head == _tail; }
+
+private:
+  EventQueue(const EventQueue&) = delete;
+  EventQueue(EventQueue&&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+  EventQueue& operator=(EventQueue&&) = delete;
+
+  T _events[capacity];
+  volatile uint32_t _head = 0;
+  volatile uint32_t _tail = 0;
+};
+
 // Adds a multiple of a given step size to a value, clamps it to a range,
 // if already at minimum or maximum, rolls over to the opposite end of the
 // range.
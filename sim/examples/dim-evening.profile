@@ -0,0 +1,6 @@
+# Dimmer evening lights that turn off earlier than the defaults.
+duskHour 19
+nightHour 22
+museumLightBrightnessEvening 6
+libraryLightBrightnessEvening 6
+activityTimeoutSeconds 20
@@ -0,0 +1,51 @@
+/*
+ * Stand-in for the ADC library.  Conversions read the voltage that the
+ * simulator applies to the pin and take a fixed time to complete.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+
+enum class ADC_CONVERSION_SPEED {
+  VERY_LOW_SPEED, LOW_SPEED, MED_SPEED, HIGH_SPEED, VERY_HIGH_SPEED
+};
+
+enum class ADC_SAMPLING_SPEED {
+  VERY_LOW_SPEED, LOW_SPEED, MED_SPEED, HIGH_SPEED, VERY_HIGH_SPEED
+};
+
+class ADC_Module {
+public:
+  // Time for a conversion with hardware averaging at low speed.
+  constexpr static uint32_t CONVERSION_MICROS = 1000;
+
+  void setResolution(uint8_t bits) { _bits = bits; }
+  void setAveraging(uint8_t samples) {}
+  void setConversionSpeed(ADC_CONVERSION_SPEED speed) {}
+  void setSamplingSpeed(ADC_SAMPLING_SPEED speed) {}
+
+  int analogRead(uint8_t pin);
+
+  bool startSingleRead(uint8_t pin);
+  bool isComplete();
+  int readSingle();
+
+private:
+  uint8_t _bits = 10;
+  uint8_t _pin = 0;
+  bool _converting = false;
+  uint32_t _startTime = 0;
+};
+
+class ADC {
+public:
+  ADC() : adc0(&_module0) {}
+
+  ADC_Module* const adc0;
+
+private:
+  ADC_Module _module0;
+};
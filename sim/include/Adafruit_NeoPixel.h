@@ -0,0 +1,53 @@
+/*
+ * Stand-in for the Adafruit NeoPixel library.  Keeps the pixels in memory
+ * and counts how often they are shown.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Arduino.h"
+
+typedef uint16_t neoPixelType;
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_RGBW ((3 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRBW ((3 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+
+  void begin() {}
+  void show();
+  bool canShow() const { return true; }
+
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w);
+  void setPixelColor(uint16_t n, uint32_t c);
+  uint32_t getPixelColor(uint16_t n) const;
+  void clear();
+
+  uint16_t numPixels() const { return _count; }
+  int16_t getPin() const { return _pin; }
+
+  // Simulator only: the colors most recently shown, packed like getPixelColor().
+  uint32_t shownColor(uint16_t n) const;
+  uint32_t showCount() const { return _showCount; }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) {
+    return (uint32_t(w) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | b;
+  }
+
+private:
+  const uint16_t _count;
+  const int16_t _pin;
+  std::vector<uint32_t> _pixels;
+  std::vector<uint32_t> _shown;
+  uint32_t _showCount = 0;
+};
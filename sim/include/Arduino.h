@@ -0,0 +1,107 @@
+/*
+ * Stand-in for the Teensyduino core, driven by the simulator's virtual clock.
+ *
+ * Time only advances when the sketch waits, such as in delay() or while
+ * idling or sleeping, so a simulation is deterministic and can run much
+ * faster than real time.  See sim.h for controlling the simulation.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+
+#define SIMULATOR 1
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+#define RISING 2
+#define FALLING 3
+#define CHANGE 4
+
+#define LED_BUILTIN 13
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define A8 22
+#define A9 23
+
+#define NUM_DIGITAL_PINS 34
+#define E2END 0x7FF
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReadResolution(unsigned int bits);
+void analogReadAveraging(unsigned int samples);
+
+void tone(uint8_t pin, uint16_t frequency, uint32_t duration = 0);
+void noTone(uint8_t pin);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin < NUM_DIGITAL_PINS ? pin : -1; }
+void attachInterrupt(uint8_t pin, void (*function)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+// Interrupts that occur while disabled are delivered once they are enabled again.
+void __disable_irq();
+void __enable_irq();
+
+void _reboot_Teensyduino_() __attribute__((noreturn));
+
+// Waits for the next interrupt such as the millisecond tick.  Stands in for
+// the processor's WFI instruction.
+void simulatorWaitForInterrupt();
+
+class usb_serial_class : public Stream {
+public:
+  void begin(long baud) {}
+  void end() {}
+
+  int available() override;
+  int read() override;
+  int peek() override;
+
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int availableForWrite() override;
+  using Print::write;
+
+  // True while the host has the port open.
+  operator bool();
+};
+
+extern usb_serial_class Serial;
+
+class teensy3_clock_class {
+public:
+  static unsigned long get();
+  static void set(unsigned long t);
+  static void compensate(int adjust) {}
+};
+
+extern teensy3_clock_class Teensy3Clock;
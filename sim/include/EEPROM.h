@@ -0,0 +1,19 @@
+/*
+ * Stand-in for the Teensy EEPROM library backed by the simulator's memory.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+
+class EEPROMClass {
+public:
+  uint8_t read(int index);
+  void write(int index, uint8_t value);
+  void update(int index, uint8_t value);
+  uint16_t length() { return E2END + 1; }
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,30 @@
+/*
+ * Stand-in for the MD_REncoder library using the same full step
+ * quadrature state machine.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+
+#define DIR_NONE 0x00
+#define DIR_CW 0x10
+#define DIR_CCW 0x20
+
+class MD_REncoder {
+public:
+  MD_REncoder(uint8_t pinA, uint8_t pinB) : _pinA(pinA), _pinB(pinB) {}
+
+  void begin();
+
+  // Advances the state machine from the current pin levels and returns
+  // the direction when a full step has completed.
+  uint8_t read();
+
+private:
+  const uint8_t _pinA;
+  const uint8_t _pinB;
+  uint8_t _state = 0;
+};
@@ -0,0 +1,17 @@
+/*
+ * Stand-in for the SPI library.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class SPIClass {
+public:
+  void begin() {}
+  void setMOSI(uint8_t pin) {}
+  void setMISO(uint8_t pin) {}
+  void setSCK(uint8_t pin) {}
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,69 @@
+/*
+ * Stand-in for the Snooze library.
+ *
+ * Sleeping advances the real-time clock until a wakeup pin changes or the
+ * alarm expires.  The millisecond clock stops while asleep like on the device.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+
+class SnoozeBlock;
+
+class SnoozeDriver {
+public:
+  virtual ~SnoozeDriver() = default;
+};
+
+class SnoozeDigital : public SnoozeDriver {
+public:
+  int pinMode(int pin, int mode, int type);
+
+  uint64_t pins() const { return _pins; }
+
+private:
+  uint64_t _pins = 0;
+};
+
+class SnoozeAlarm : public SnoozeDriver {
+public:
+  // Wakes after the given amount of time.
+  void setRtcTimer(uint8_t hours, uint8_t minutes, uint8_t seconds);
+
+  uint32_t seconds() const { return _seconds; }
+
+private:
+  uint32_t _seconds = 0;
+};
+
+class SnoozeTimer : public SnoozeDriver {
+public:
+  // Wakes after the given number of milliseconds.
+  void setTimer(uint16_t period) { _period = period; }
+
+  uint16_t period() const { return _period; }
+
+private:
+  uint16_t _period = 0;
+};
+
+class SnoozeUSBSerial : public SnoozeDriver {};
+
+class SnoozeClass {
+public:
+  // Returns the wakeup source: the pin number for digital wakeups
+  // or one of the module numbers below, as Snooze's Teensy 3.x driver does.
+  int sleep(SnoozeBlock& block);
+  int deepSleep(SnoozeBlock& block) { return sleep(block); }
+  int hibernate(SnoozeBlock& block) { return sleep(block); }
+};
+
+constexpr int SNOOZE_SOURCE_CMP = 34;
+constexpr int SNOOZE_SOURCE_RTC_ALARM = 35;
+constexpr int SNOOZE_SOURCE_LPTMR = 36;
+constexpr int SNOOZE_SOURCE_TSI = 37;
+
+extern SnoozeClass Snooze;
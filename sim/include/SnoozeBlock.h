@@ -0,0 +1,24 @@
+/*
+ * Stand-in for the Snooze library's block of wakeup drivers.
+ */
+
+#pragma once
+
+#include "Snooze.h"
+
+class SnoozeBlock {
+public:
+  constexpr static unsigned MAX_DRIVERS = 8;
+
+  template <typename... Drivers>
+  SnoozeBlock(Drivers&... drivers) : _drivers{&drivers...}, _count(sizeof...(drivers)) {
+    static_assert(sizeof...(drivers) <= MAX_DRIVERS, "too many drivers");
+  }
+
+  SnoozeDriver* driver(unsigned i) const { return _drivers[i]; }
+  unsigned count() const { return _count; }
+
+private:
+  SnoozeDriver* _drivers[MAX_DRIVERS];
+  unsigned _count;
+};
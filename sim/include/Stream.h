@@ -0,0 +1,14 @@
+/*
+ * Stand-in for the Arduino Stream class.
+ */
+
+#pragma once
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
@@ -0,0 +1,96 @@
+/*
+ * Stand-in for the U8g2 library with a full frame buffer.
+ *
+ * Drawing updates the buffer in the same tile layout as U8g2 so that
+ * sending only the changed tiles can be exercised.  Text is drawn as
+ * placeholder glyphs that depend on the character so that changes to
+ * text change the buffer.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+#include "Print.h"
+
+struct u8g2_cb_struct {
+  bool flip;
+};
+typedef struct u8g2_cb_struct u8g2_cb_t;
+
+extern const u8g2_cb_t* const U8G2_R0;
+extern const u8g2_cb_t* const U8G2_R2;
+
+// Stand-in fonts only hold their glyph width and height.
+extern const uint8_t u8g2_font_4x6_tr[];
+extern const uint8_t u8g2_font_miranda_nbp_tr[];
+extern const uint8_t u8g2_font_prospero_bold_nbp_tr[];
+extern const uint8_t u8g2_font_open_iconic_embedded_1x_t[];
+extern const uint8_t u8g2_font_open_iconic_gui_1x_t[];
+
+class U8G2 : public Print {
+public:
+  constexpr static uint8_t WIDTH = 128;
+  constexpr static uint8_t HEIGHT = 64;
+  constexpr static uint8_t TILE_WIDTH = WIDTH / 8;
+  constexpr static uint8_t TILE_HEIGHT = HEIGHT / 8;
+
+  explicit U8G2(const u8g2_cb_t* rotation) {}
+
+  bool begin() { return true; }
+  void setPowerSave(uint8_t enable) { _powerSave = enable; }
+
+  void clearBuffer();
+  void sendBuffer();
+  void updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th);
+  uint8_t* getBufferPtr() { return _buffer; }
+  uint8_t getBufferTileWidth() const { return TILE_WIDTH; }
+  uint8_t getBufferTileHeight() const { return TILE_HEIGHT; }
+
+  int getDisplayWidth() const { return WIDTH; }
+  int getDisplayHeight() const { return HEIGHT; }
+
+  void setDrawColor(uint8_t color) { _drawColor = color; }
+  void drawPixel(int x, int y);
+  void drawHLine(int x, int y, int w);
+  void drawVLine(int x, int y, int h);
+  void drawLine(int x0, int y0, int x1, int y1);
+  void drawBox(int x, int y, int w, int h);
+  void drawFrame(int x, int y, int w, int h);
+
+  void setFont(const uint8_t* font) { _font = font; }
+  void setFontMode(uint8_t transparent) {}
+  void setFontPosTop() { _fontPosTop = true; }
+  void setFontPosBaseline() { _fontPosTop = false; }
+  int getMaxCharHeight() const { return _font ? _font[1] : 0; }
+  int getStrWidth(const char* str) const;
+  int drawStr(int x, int y, const char* str);
+  int drawGlyph(int x, int y, uint16_t encoding);
+
+  void home() { _cursorX = 0; _cursorY = 0; }
+  void setCursor(int x, int y) { _cursorX = x; _cursorY = y; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Simulator only: counts of tiles sent to the display and whether it is on.
+  uint32_t tilesSent() const { return _tilesSent; }
+  bool isPoweredOn() const { return !_powerSave; }
+
+private:
+  uint8_t _buffer[WIDTH * HEIGHT / 8] = {};
+  const uint8_t* _font = nullptr;
+  bool _fontPosTop = false;
+  uint8_t _drawColor = 1;
+  uint8_t _powerSave = 0;
+  int _cursorX = 0;
+  int _cursorY = 0;
+  uint32_t _tilesSent = 0;
+};
+
+class U8G2_ST7567_OS12864_F_4W_HW_SPI : public U8G2 {
+public:
+  U8G2_ST7567_OS12864_F_4W_HW_SPI(const u8g2_cb_t* rotation, uint8_t cs, uint8_t dc,
+      uint8_t reset) : U8G2(rotation) {}
+};
@@ -0,0 +1,35 @@
+/*
+ * Stand-in for the Arduino String class, backed by std::string.
+ */
+
+#pragma once
+
+#include <string>
+
+class String {
+public:
+  String() = default;
+  String(const char* str) : _str(str ? str : "") {}
+  String(const std::string& str) : _str(str) {}
+  explicit String(char c) : _str(1, c) {}
+  explicit String(int n) : _str(std::to_string(n)) {}
+  explicit String(unsigned n) : _str(std::to_string(n)) {}
+  explicit String(long n) : _str(std::to_string(n)) {}
+  explicit String(unsigned long n) : _str(std::to_string(n)) {}
+
+  const char* c_str() const { return _str.c_str(); }
+  unsigned length() const { return unsigned(_str.size()); }
+
+  String& operator+=(const String& other) { _str += other._str; return *this; }
+  String& operator+=(const char* other) { _str += other; return *this; }
+  String& operator+=(char c) { _str += c; return *this; }
+  friend String operator+(String a, const String& b) { a += b; return a; }
+  friend String operator+(String a, const char* b) { a += b; return a; }
+  friend String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+
+  bool operator==(const String& other) const { return _str == other._str; }
+  bool operator!=(const String& other) const { return _str != other._str; }
+
+private:
+  std::string _str;
+};
@@ -0,0 +1,49 @@
+/*
+ * Stand-in for the avdweb Switch library: debounced push buttons and
+ * switches with click, double click, and long press detection.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+
+class Switch {
+public:
+  Switch(uint8_t pin, uint8_t pinMode = INPUT_PULLUP, bool polarity = LOW,
+      uint32_t debouncePeriod = 50, uint32_t longPressPeriod = 300,
+      uint32_t doubleClickPeriod = 250);
+
+  // Reads the pin.  Returns true if the debounced state switched.
+  bool poll();
+
+  // These are only valid until the next poll.
+  bool switched() const { return _switched; }
+  bool on() const { return _on; }
+  bool pushed() const { return _switched && _on; }
+  bool released() const { return _switched && !_on; }
+  bool longPress() const { return _longPress; }
+  bool doubleClick() const { return _doubleClick; }
+  bool singleClick() const { return _singleClick; }
+
+private:
+  const uint8_t _pin;
+  const bool _polarity;
+  const uint32_t _debouncePeriod;
+  const uint32_t _longPressPeriod;
+  const uint32_t _doubleClickPeriod;
+
+  bool _on = false;
+  bool _switched = false;
+  bool _longPress = false;
+  bool _doubleClick = false;
+  bool _singleClick = false;
+
+  uint32_t _switchedTime = 0;
+  uint32_t _pushedTime = 0;
+  uint32_t _releasedTime = 0;
+  bool _longPressReported = false;
+  bool _clickPending = false;
+  bool _suppressClick = false;
+};
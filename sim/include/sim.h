@@ -0,0 +1,87 @@
+/*
+ * Controls the simulated Teensy that the stand-in libraries run on.
+ *
+ * The simulation keeps two clocks like the device: the real-time clock,
+ * which always runs, and the millisecond clock, which stops while asleep.
+ * Neither advances on its own.  Time passes when the sketch waits, such
+ * as in delay(), when idling until the next interrupt, or while asleep,
+ * and when a test advances it explicitly.
+ *
+ * Pin changes can be applied immediately or scheduled for a later time.
+ * Scheduled changes are applied as the clocks pass them and wake the
+ * simulated processor from sleep if the pin is a wakeup source.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <time.h>
+
+namespace sim {
+
+// Noon on Saturday, June 1st 2024 UTC.
+constexpr time_t DEFAULT_START_TIME = 1717243200;
+
+// Resets time, pins, analog voltages, serial buffers, and erases the EEPROM.
+void reset(time_t startTime = DEFAULT_START_TIME);
+
+// Microseconds of real time since the simulation started, asleep or awake.
+uint64_t elapsedMicros();
+
+// Microseconds of real time spent asleep.
+uint64_t asleepMicros();
+
+// Number of times the processor went to sleep.
+uint32_t sleepCount();
+
+// Advances both clocks while awake, applying scheduled pin changes and
+// running interrupt handlers along the way.
+void advanceMicros(uint64_t micros);
+void advanceMillis(uint64_t millis);
+
+// Advances both clocks until the given real time.
+void advanceUntil(uint64_t elapsedMicros);
+
+// Sets the time at which sleeping gives up waiting for a wakeup that
+// will never come.  Sleeping past this time ends the simulation.
+void setEndTime(uint64_t elapsedMicros);
+bool finished();
+
+// Drives an input pin, running its interrupt handler on a matching edge.
+void setPin(int pin, int level);
+
+// Stops driving an input pin so it reads as its pull-up or pull-down.
+void releasePin(int pin);
+
+// Drives an input pin at a later real time.
+void schedulePin(uint64_t elapsedMicros, int pin, int level);
+
+// Gets the level most recently written to an output pin.
+int outputLevel(int pin);
+
+// Applies a voltage to an analog pin.
+void setAnalogMillivolts(int pin, uint32_t millivolts);
+uint32_t analogMillivolts(int pin);
+
+// Queues input for the USB serial port and collects its output.
+// Output is also echoed to stdout if enabled.
+void serialInput(const std::string& text);
+std::string takeSerialOutput();
+void setSerialEcho(bool echo);
+void setSerialConnected(bool connected);
+
+// Number of times NeoPixels connected to the pin were updated.
+uint32_t pixelShowCount(int pin);
+
+// Direct access to the EEPROM contents and the number of bytes written.
+uint8_t* eeprom();
+uint32_t eepromWriteCount();
+
+// Puts the processor to sleep until a pin in the mask changes level or the
+// real-time clock reaches the alarm time.  Used by the Snooze stand-in.
+// Returns the pin number, alarmSource for the alarm, or -1 if the
+// simulation ended first.
+int sleep(uint64_t wakePins, time_t alarmTime, int alarmSource);
+
+} // namespace sim
@@ -0,0 +1,222 @@
+// Runs the controller sketch on the simulated Teensy for a number of days
+// using the virtual clock and prints a summary of the run.
+//
+// A settings profile and a door event script can be replayed to see how
+// they affect energy consumption.  The profile has one setting per line
+// as accepted by the serial console's set command, such as "dawnHour 6".
+// The script has one event per line such as "17:30 library open" and is
+// repeated every day.  Lines starting with # are ignored in both.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+#include "sim.h"
+
+void setup();
+void loop();
+
+namespace {
+constexpr int VBAT_PIN = A6;
+constexpr int LIGHTS_PIN = 21;
+constexpr int MUSEUM_DOOR_PIN = 0;
+constexpr int LIBRARY_DOOR_PIN = 1;
+
+// The door switches close when the doors are closed.
+constexpr int DOOR_CLOSED = LOW;
+constexpr int DOOR_OPEN = HIGH;
+
+struct DoorEvent {
+  uint32_t secondsOfDay;
+  int pin;
+  int level;
+};
+
+[[noreturn]] void fail(const char* format, const char* file, unsigned line) {
+  fprintf(stderr, format, file, line);
+  exit(1);
+}
+
+std::vector<std::string> readLines(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    perror(path);
+    exit(1);
+  }
+  std::vector<std::string> lines;
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), file)) {
+    std::string line(buffer);
+    line.erase(line.find_last_not_of(" \t\r\n") + 1);
+    line.erase(0, line.find_first_not_of(" \t"));
+    lines.push_back(line);
+  }
+  fclose(file);
+  return lines;
+}
+
+std::string readProfile(const char* path) {
+  std::string commands;
+  for (std::string line : readLines(path)) {
+    if (line.empty() || line[0] == '#') continue;
+    // Also accept the "name = value" form printed by the get command.
+    const size_t equals = line.find('=');
+    if (equals != std::string::npos) line[equals] = ' ';
+    commands += "set " + line + "\n";
+  }
+  return commands;
+}
+
+std::vector<DoorEvent> readDoorScript(const char* path) {
+  std::vector<DoorEvent> events;
+  unsigned lineNumber = 0;
+  for (const std::string& line : readLines(path)) {
+    lineNumber++;
+    if (line.empty() || line[0] == '#') continue;
+
+    unsigned hours, minutes, seconds = 0;
+    char door[16], state[16];
+    if (sscanf(line.c_str(), "%u:%u:%u %15s %15s", &hours, &minutes, &seconds, door, state) != 5
+        && sscanf(line.c_str(), "%u:%u %15s %15s", &hours, &minutes, door, state) != 4) {
+      fail("%s:%u: expected HH:MM[:SS] museum|library open|closed\n", path, lineNumber);
+    }
+    DoorEvent event{hours * 3600 + minutes * 60 + seconds, 0, 0};
+    if (!strcmp(door, "museum")) {
+      event.pin = MUSEUM_DOOR_PIN;
+    } else if (!strcmp(door, "library")) {
+      event.pin = LIBRARY_DOOR_PIN;
+    } else {
+      fail("%s:%u: door must be museum or library\n", path, lineNumber);
+    }
+    if (!strcmp(state, "open")) {
+      event.level = DOOR_OPEN;
+    } else if (!strcmp(state, "closed")) {
+      event.level = DOOR_CLOSED;
+    } else {
+      fail("%s:%u: door state must be open or closed\n", path, lineNumber);
+    }
+    events.push_back(event);
+  }
+  return events;
+}
+
+// Schedules the door events for every day that the simulation covers.
+void scheduleDoorEvents(const std::vector<DoorEvent>& events, time_t start, double days) {
+  const time_t firstDay = previousMidnight(start);
+  for (time_t day = firstDay; day < start + time_t(days * SECS_PER_DAY); day += SECS_PER_DAY) {
+    for (const DoorEvent& event : events) {
+      const time_t time = day + event.secondsOfDay;
+      if (time < start) continue;
+      sim::schedulePin(uint64_t(time - start) * 1000000, event.pin, event.level);
+    }
+  }
+}
+
+// Runs the sketch until the simulation ends.
+uint64_t run() {
+  uint64_t iterations = 0;
+  while (!sim::finished()) {
+    loop();
+    iterations++;
+  }
+  return iterations;
+}
+
+// Runs the sketch a little longer to execute console commands.
+std::string runCommands(const std::string& commands) {
+  sim::takeSerialOutput();
+  sim::serialInput(commands);
+  sim::setEndTime(sim::elapsedMicros() + 2000000);
+  run();
+  return sim::takeSerialOutput();
+}
+
+void usage(const char* program) {
+  fprintf(stderr,
+      "usage: %s [options]\n"
+      "  --days N        number of days to simulate (default 7)\n"
+      "  --start TIME    start time in seconds since 1970 (default %ld)\n"
+      "  --battery MV    battery voltage in millivolts (default 3900)\n"
+      "  --profile FILE  apply the settings in the file\n"
+      "  --doors FILE    replay the door events in the file every day\n"
+      "  --report        print the energy used in each hour of the last day\n"
+      "  --serial        echo the sketch's serial output\n",
+      program, long(sim::DEFAULT_START_TIME));
+  exit(2);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  double days = 7;
+  time_t start = sim::DEFAULT_START_TIME;
+  uint32_t batteryMillivolts = 3900;
+  bool serial = false;
+  bool report = false;
+  const char* profile = nullptr;
+  const char* doors = nullptr;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--days") && hasValue) {
+      days = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--start") && hasValue) {
+      start = time_t(atoll(argv[++i]));
+    } else if (!strcmp(argv[i], "--battery") && hasValue) {
+      batteryMillivolts = uint32_t(atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--profile") && hasValue) {
+      profile = argv[++i];
+    } else if (!strcmp(argv[i], "--doors") && hasValue) {
+      doors = argv[++i];
+    } else if (!strcmp(argv[i], "--report")) {
+      report = true;
+    } else if (!strcmp(argv[i], "--serial")) {
+      serial = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  sim::reset(start);
+  sim::setSerialEcho(serial);
+  sim::setAnalogMillivolts(VBAT_PIN, batteryMillivolts / 2); // halved by the voltage divider
+  sim::setPin(MUSEUM_DOOR_PIN, DOOR_CLOSED);
+  sim::setPin(LIBRARY_DOOR_PIN, DOOR_CLOSED);
+  if (doors) scheduleDoorEvents(readDoorScript(doors), start, days);
+
+  const auto wallStart = std::chrono::steady_clock::now();
+  setup();
+  if (profile) {
+    const std::string output = runCommands(readProfile(profile));
+    if (output.find("error") != std::string::npos) {
+      fprintf(stderr, "%s: %s", profile, output.c_str());
+      return 1;
+    }
+  }
+
+  sim::setEndTime(uint64_t(days * SECS_PER_DAY) * 1000000);
+  const uint64_t iterations = run();
+  const double wallSeconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - wallStart).count();
+
+  const double simSeconds = sim::elapsedMicros() * 1e-6;
+  const double awakeSeconds = (sim::elapsedMicros() - sim::asleepMicros()) * 1e-6;
+  printf("Simulated %.1f days in %.2f s (%.0fx real time)\n",
+      simSeconds / 86400, wallSeconds, simSeconds / std::max(wallSeconds, 1e-6));
+  printf("Awake %.2f%% of the time, slept %u times\n",
+      awakeSeconds * 100 / simSeconds, sim::sleepCount());
+  printf("Loop iterations: %llu\n", (unsigned long long)iterations);
+  printf("Strip updates: %u\n", sim::pixelShowCount(LIGHTS_PIN));
+  printf("EEPROM bytes written: %u\n", sim::eepromWriteCount());
+  if (report) {
+    // The reply to the command comes after anything else the sketch printed.
+    const std::string output = runCommands("energy\n");
+    const size_t table = output.rfind("Hour ");
+    printf("\n%s", output.substr(table == std::string::npos ? 0 : table).c_str());
+  }
+  return 0;
+}
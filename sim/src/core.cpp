@@ -0,0 +1,361 @@
+// Virtual clocks, pins, interrupts, USB serial, and EEPROM of the simulated Teensy.
+
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <TimeLib.h>
+
+#include "sim.h"
+
+namespace {
+constexpr uint32_t ANALOG_REFERENCE_MILLIVOLTS = 3300;
+constexpr int USB_BUFFER_SIZE = 64;
+constexpr uint64_t NEVER = UINT64_MAX;
+
+struct Pin {
+  uint8_t mode = INPUT;
+  uint8_t driven = 0; // 0 if not driven, otherwise level + 1
+  uint8_t output = LOW;
+  uint32_t millivolts = 0;
+  void (*handler)() = nullptr;
+  int handlerMode = 0;
+  bool pending = false;
+};
+
+struct PinChange {
+  uint64_t time;
+  uint64_t sequence;
+  int pin;
+  int level;
+};
+
+uint64_t elapsed = 0;
+uint64_t awake = 0;
+uint64_t asleep = 0;
+uint64_t endTime = NEVER;
+bool ended = false;
+uint32_t sleeps = 0;
+time_t rtcBase = sim::DEFAULT_START_TIME;
+
+Pin pins[NUM_DIGITAL_PINS];
+std::vector<PinChange> pinChanges; // ordered by time then sequence
+uint64_t pinChangeSequence = 0;
+bool irqDisabled = false;
+unsigned analogBits = 10;
+
+std::string serialIn;
+size_t serialInPos = 0;
+std::string serialOut;
+bool serialEcho = false;
+bool serialConnected = true;
+
+uint8_t eepromData[E2END + 1];
+uint32_t eepromWrites = 0;
+
+// Erased EEPROM reads as all ones.
+struct EepromEraser {
+  EepromEraser() { std::fill(std::begin(eepromData), std::end(eepromData), 0xff); }
+} eepromEraser;
+
+int readPin(const Pin& pin) {
+  if (pin.mode == OUTPUT) return pin.output;
+  if (pin.driven) return pin.driven - 1;
+  return pin.mode == INPUT_PULLDOWN ? LOW : HIGH;
+}
+
+void runHandler(Pin& pin) {
+  if (irqDisabled) {
+    pin.pending = true; // the hardware latches one pending interrupt per pin
+  } else {
+    pin.handler();
+  }
+}
+
+// Returns true if the pin's level changed.
+bool drivePin(int index, uint8_t driven) {
+  if (index < 0 || index >= NUM_DIGITAL_PINS) return false;
+  Pin& pin = pins[index];
+  const int before = readPin(pin);
+  pin.driven = driven;
+  const int after = readPin(pin);
+  if (before == after) return false;
+
+  if (pin.handler) {
+    if (pin.handlerMode == CHANGE
+        || (pin.handlerMode == RISING && after == HIGH)
+        || (pin.handlerMode == FALLING && after == LOW)) {
+      runHandler(pin);
+    }
+  }
+  return true;
+}
+
+uint64_t nextPinChangeTime() {
+  return pinChanges.empty() ? NEVER : pinChanges.front().time;
+}
+
+// Applies the next scheduled pin change.  Returns its pin if the level changed or -1.
+int applyNextPinChange() {
+  const PinChange change = pinChanges.front();
+  pinChanges.erase(pinChanges.begin());
+  return drivePin(change.pin, uint8_t(change.level + 1)) ? change.pin : -1;
+}
+
+void passTime(uint64_t until, bool isAwake) {
+  if (until <= elapsed) return;
+  const uint64_t delta = until - elapsed;
+  elapsed = until;
+  if (isAwake) {
+    awake += delta;
+  } else {
+    asleep += delta;
+  }
+}
+
+void advanceAwakeUntil(uint64_t until) {
+  while (nextPinChangeTime() <= until) {
+    passTime(nextPinChangeTime(), true);
+    applyNextPinChange();
+  }
+  passTime(until, true);
+}
+} // namespace
+
+namespace sim {
+
+void reset(time_t startTime) {
+  elapsed = 0;
+  awake = 0;
+  asleep = 0;
+  endTime = NEVER;
+  ended = false;
+  sleeps = 0;
+  rtcBase = startTime;
+
+  // Pin modes and interrupt handlers belong to the sketch so keep them.
+  for (Pin& pin : pins) {
+    pin.driven = 0;
+    pin.output = LOW;
+    pin.millivolts = 0;
+    pin.pending = false;
+  }
+  pinChanges.clear();
+  irqDisabled = false;
+  analogBits = 10;
+
+  serialIn.clear();
+  serialInPos = 0;
+  serialOut.clear();
+  serialConnected = true;
+
+  std::fill(std::begin(eepromData), std::end(eepromData), 0xff);
+  eepromWrites = 0;
+
+  // Restart the time library's clock along with the millisecond clock.
+  setTime(startTime);
+}
+
+uint64_t elapsedMicros() { return elapsed; }
+uint64_t asleepMicros() { return asleep; }
+uint32_t sleepCount() { return sleeps; }
+
+void advanceMicros(uint64_t micros) { advanceAwakeUntil(elapsed + micros); }
+void advanceMillis(uint64_t millis) { advanceAwakeUntil(elapsed + millis * 1000); }
+void advanceUntil(uint64_t elapsedMicros) { advanceAwakeUntil(elapsedMicros); }
+
+void setEndTime(uint64_t elapsedMicros) {
+  endTime = elapsedMicros;
+  ended = false;
+}
+
+bool finished() { return ended || elapsed >= endTime; }
+
+void setPin(int pin, int level) { drivePin(pin, uint8_t((level ? HIGH : LOW) + 1)); }
+void releasePin(int pin) { drivePin(pin, 0); }
+
+void schedulePin(uint64_t elapsedMicros, int pin, int level) {
+  PinChange change{std::max(elapsedMicros, elapsed), pinChangeSequence++, pin, level ? HIGH : LOW};
+  auto it = std::upper_bound(pinChanges.begin(), pinChanges.end(), change,
+      [](const PinChange& a, const PinChange& b) {
+        return a.time < b.time || (a.time == b.time && a.sequence < b.sequence);
+      });
+  pinChanges.insert(it, change);
+}
+
+int outputLevel(int pin) { return pins[pin].output; }
+
+void setAnalogMillivolts(int pin, uint32_t millivolts) { pins[pin].millivolts = millivolts; }
+uint32_t analogMillivolts(int pin) { return pins[pin].millivolts; }
+
+void serialInput(const std::string& text) {
+  serialIn.erase(0, serialInPos);
+  serialInPos = 0;
+  serialIn += text;
+}
+
+std::string takeSerialOutput() {
+  std::string output;
+  output.swap(serialOut);
+  return output;
+}
+
+void setSerialEcho(bool echo) { serialEcho = echo; }
+void setSerialConnected(bool connected) { serialConnected = connected; }
+
+uint8_t* eeprom() { return eepromData; }
+uint32_t eepromWriteCount() { return eepromWrites; }
+
+int sleep(uint64_t wakePins, time_t alarmTime, int alarmSource) {
+  sleeps++;
+  const uint64_t alarmAt = alarmTime
+      ? uint64_t(std::max<int64_t>(alarmTime - rtcBase, 0)) * 1000000 : NEVER;
+  for (;;) {
+    const uint64_t wake = std::min(alarmAt, nextPinChangeTime());
+    if (wake >= endTime) {
+      passTime(std::max(endTime, elapsed), false);
+      ended = true;
+      return -1;
+    }
+    if (wake == alarmAt) {
+      passTime(alarmAt, false);
+      return alarmSource;
+    }
+    passTime(wake, false);
+    const int pin = applyNextPinChange();
+    if (pin >= 0 && (wakePins & (uint64_t(1) << pin))) return pin;
+  }
+}
+
+} // namespace sim
+
+uint32_t millis() { return uint32_t(awake / 1000); }
+uint32_t micros() { return uint32_t(awake); }
+void delay(uint32_t ms) { sim::advanceMillis(ms); }
+void delayMicroseconds(uint32_t us) { sim::advanceMicros(us); }
+void yield() {}
+
+void simulatorWaitForInterrupt() {
+  // Wake for the next millisecond tick unless a pin changes first.
+  const uint64_t tick = elapsed + (1000 - awake % 1000);
+  const uint64_t change = nextPinChangeTime();
+  if (change < tick) {
+    passTime(change, true);
+    applyNextPinChange();
+  } else {
+    advanceAwakeUntil(tick);
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NUM_DIGITAL_PINS) pins[pin].mode = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < NUM_DIGITAL_PINS) pins[pin].output = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? readPin(pins[pin]) : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  if (pin >= NUM_DIGITAL_PINS) return 0;
+  const uint32_t full = (1U << analogBits) - 1;
+  const uint32_t millivolts = std::min(pins[pin].millivolts, ANALOG_REFERENCE_MILLIVOLTS);
+  return int((uint64_t(millivolts) * full + ANALOG_REFERENCE_MILLIVOLTS / 2) / ANALOG_REFERENCE_MILLIVOLTS);
+}
+
+void analogReadResolution(unsigned int bits) { analogBits = bits; }
+void analogReadAveraging(unsigned int samples) {}
+
+void tone(uint8_t pin, uint16_t frequency, uint32_t duration) {}
+void noTone(uint8_t pin) {}
+
+void attachInterrupt(uint8_t pin, void (*function)(), int mode) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  pins[pin].handler = function;
+  pins[pin].handlerMode = mode;
+  pins[pin].pending = false;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < NUM_DIGITAL_PINS) pins[pin].handler = nullptr;
+}
+
+void __disable_irq() { irqDisabled = true; }
+
+void __enable_irq() {
+  irqDisabled = false;
+  for (Pin& pin : pins) {
+    if (pin.pending) {
+      pin.pending = false;
+      if (pin.handler) pin.handler();
+    }
+  }
+}
+
+void _reboot_Teensyduino_() {
+  fflush(stdout);
+  fprintf(stderr, "simulator: sketch requested a reboot\n");
+  exit(0);
+}
+
+int usb_serial_class::available() {
+  return serialConnected ? int(serialIn.size() - serialInPos) : 0;
+}
+
+int usb_serial_class::read() {
+  return available() > 0 ? uint8_t(serialIn[serialInPos++]) : -1;
+}
+
+int usb_serial_class::peek() {
+  return available() > 0 ? uint8_t(serialIn[serialInPos]) : -1;
+}
+
+size_t usb_serial_class::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t usb_serial_class::write(const uint8_t* buffer, size_t size) {
+  if (!serialConnected) return 0;
+  serialOut.append(reinterpret_cast<const char*>(buffer), size);
+  if (serialEcho) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+int usb_serial_class::availableForWrite() {
+  return serialConnected ? USB_BUFFER_SIZE : 0;
+}
+
+usb_serial_class::operator bool() { return serialConnected; }
+
+usb_serial_class Serial;
+
+unsigned long teensy3_clock_class::get() {
+  return (unsigned long)(rtcBase + time_t(elapsed / 1000000));
+}
+
+void teensy3_clock_class::set(unsigned long t) {
+  rtcBase = time_t(t) - time_t(elapsed / 1000000);
+}
+
+teensy3_clock_class Teensy3Clock;
+
+uint8_t EEPROMClass::read(int index) {
+  return index >= 0 && index <= E2END ? eepromData[index] : 0;
+}
+
+void EEPROMClass::write(int index, uint8_t value) {
+  if (index < 0 || index > E2END) return;
+  eepromData[index] = value;
+  eepromWrites++;
+}
+
+void EEPROMClass::update(int index, uint8_t value) {
+  if (read(index) != value) write(index, value);
+}
+
+EEPROMClass EEPROM;
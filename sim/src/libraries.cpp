@@ -0,0 +1,312 @@
+// Stand-ins for the third party libraries used by the sketch.
+
+#include <algorithm>
+
+#include <ADC.h>
+#include <Adafruit_NeoPixel.h>
+#include <avdweb_Switch.h>
+#include <MD_REncoder.h>
+#include <Snooze.h>
+#include <SnoozeBlock.h>
+#include <SPI.h>
+#include <U8g2lib.h>
+
+#include "sim.h"
+
+// ADC
+
+int ADC_Module::analogRead(uint8_t pin) {
+  analogReadResolution(_bits);
+  return ::analogRead(pin);
+}
+
+bool ADC_Module::startSingleRead(uint8_t pin) {
+  _pin = pin;
+  _converting = true;
+  _startTime = micros();
+  return true;
+}
+
+bool ADC_Module::isComplete() {
+  return _converting && micros() - _startTime >= CONVERSION_MICROS;
+}
+
+int ADC_Module::readSingle() {
+  _converting = false;
+  return analogRead(_pin);
+}
+
+// Adafruit NeoPixel
+
+namespace {
+uint32_t pixelShows[NUM_DIGITAL_PINS];
+} // namespace
+
+uint32_t sim::pixelShowCount(int pin) {
+  return pin >= 0 && pin < NUM_DIGITAL_PINS ? pixelShows[pin] : 0;
+}
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t pin, neoPixelType type) :
+    _count(n), _pin(pin), _pixels(n), _shown(n) {}
+
+void Adafruit_NeoPixel::show() {
+  // The real library disables interrupts while sending the data.
+  __disable_irq();
+  _shown = _pixels;
+  _showCount++;
+  if (_pin >= 0 && _pin < NUM_DIGITAL_PINS) pixelShows[_pin]++;
+  __enable_irq();
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  setPixelColor(n, Color(r, g, b));
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+  setPixelColor(n, Color(r, g, b, w));
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
+  if (n < _count) _pixels[n] = c;
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
+  return n < _count ? _pixels[n] : 0;
+}
+
+void Adafruit_NeoPixel::clear() {
+  std::fill(_pixels.begin(), _pixels.end(), 0);
+}
+
+uint32_t Adafruit_NeoPixel::shownColor(uint16_t n) const {
+  return n < _count ? _shown[n] : 0;
+}
+
+// avdweb Switch
+
+Switch::Switch(uint8_t pin, uint8_t mode, bool polarity, uint32_t debouncePeriod,
+    uint32_t longPressPeriod, uint32_t doubleClickPeriod) :
+    _pin(pin), _polarity(polarity), _debouncePeriod(debouncePeriod),
+    _longPressPeriod(longPressPeriod), _doubleClickPeriod(doubleClickPeriod) {
+  pinMode(pin, mode);
+  _on = digitalRead(pin) == polarity;
+  _switchedTime = millis();
+}
+
+bool Switch::poll() {
+  const uint32_t time = millis();
+  const bool input = digitalRead(_pin) == _polarity;
+
+  _switched = false;
+  _longPress = false;
+  _doubleClick = false;
+  _singleClick = false;
+
+  if (input != _on && time - _switchedTime >= _debouncePeriod) {
+    _on = input;
+    _switched = true;
+    _switchedTime = time;
+  }
+
+  if (_switched && _on) {
+    // A second push soon after a click makes it a double click.
+    _suppressClick = _clickPending && time - _releasedTime < _doubleClickPeriod;
+    _doubleClick = _suppressClick;
+    _clickPending = false;
+    _pushedTime = time;
+    _longPressReported = false;
+  } else if (_switched && !_on) {
+    _clickPending = !_longPressReported && !_suppressClick;
+    _releasedTime = time;
+  }
+
+  if (_on && !_longPressReported && time - _pushedTime >= _longPressPeriod) {
+    _longPress = true;
+    _longPressReported = true;
+  }
+
+  if (!_on && _clickPending && time - _releasedTime >= _doubleClickPeriod) {
+    _singleClick = true;
+    _clickPending = false;
+  }
+  return _switched;
+}
+
+// MD_REncoder
+
+namespace {
+// Full step state machine from Ben Buxton's rotary encoder library.
+constexpr uint8_t R_START = 0x0;
+constexpr uint8_t R_CW_FINAL = 0x1;
+constexpr uint8_t R_CW_BEGIN = 0x2;
+constexpr uint8_t R_CW_NEXT = 0x3;
+constexpr uint8_t R_CCW_BEGIN = 0x4;
+constexpr uint8_t R_CCW_FINAL = 0x5;
+constexpr uint8_t R_CCW_NEXT = 0x6;
+
+constexpr uint8_t ENCODER_TABLE[7][4] = {
+  {R_START, R_CW_BEGIN, R_CCW_BEGIN, R_START},
+  {R_CW_NEXT, R_START, R_CW_FINAL, R_START | DIR_CW},
+  {R_CW_NEXT, R_CW_BEGIN, R_START, R_START},
+  {R_CW_NEXT, R_CW_BEGIN, R_CW_FINAL, R_START},
+  {R_CCW_NEXT, R_START, R_CCW_BEGIN, R_START},
+  {R_CCW_NEXT, R_CCW_FINAL, R_START, R_START | DIR_CCW},
+  {R_CCW_NEXT, R_CCW_FINAL, R_CCW_BEGIN, R_START},
+};
+} // namespace
+
+void MD_REncoder::begin() {
+  pinMode(_pinA, INPUT_PULLUP);
+  pinMode(_pinB, INPUT_PULLUP);
+}
+
+uint8_t MD_REncoder::read() {
+  const uint8_t pins = uint8_t((digitalRead(_pinB) << 1) | digitalRead(_pinA));
+  _state = ENCODER_TABLE[_state & 0xf][pins];
+  return _state & 0x30;
+}
+
+// Snooze
+
+int SnoozeDigital::pinMode(int pin, int mode, int type) {
+  ::pinMode(pin, mode);
+  _pins |= uint64_t(1) << pin;
+  return pin;
+}
+
+void SnoozeAlarm::setRtcTimer(uint8_t hours, uint8_t minutes, uint8_t seconds) {
+  _seconds = hours * 3600UL + minutes * 60UL + seconds;
+}
+
+int SnoozeClass::sleep(SnoozeBlock& block) {
+  uint64_t pins = 0;
+  time_t alarmTime = 0;
+  int alarmSource = 0;
+  for (unsigned i = 0; i < block.count(); i++) {
+    SnoozeDriver* driver = block.driver(i);
+    if (auto* digital = dynamic_cast<SnoozeDigital*>(driver)) {
+      pins |= digital->pins();
+    } else if (auto* alarm = dynamic_cast<SnoozeAlarm*>(driver)) {
+      if (alarm->seconds()) {
+        alarmTime = time_t(Teensy3Clock.get()) + alarm->seconds();
+        alarmSource = SNOOZE_SOURCE_RTC_ALARM;
+      }
+    } else if (auto* timer = dynamic_cast<SnoozeTimer*>(driver)) {
+      if (timer->period()) {
+        alarmTime = time_t(Teensy3Clock.get()) + std::max(timer->period() / 1000, 1);
+        alarmSource = SNOOZE_SOURCE_LPTMR;
+      }
+    }
+  }
+  return sim::sleep(pins, alarmTime, alarmSource);
+}
+
+SnoozeClass Snooze;
+
+// SPI
+
+SPIClass SPI;
+
+// U8g2
+
+namespace {
+const u8g2_cb_t rotation0{false};
+const u8g2_cb_t rotation180{true};
+} // namespace
+
+const u8g2_cb_t* const U8G2_R0 = &rotation0;
+const u8g2_cb_t* const U8G2_R2 = &rotation180;
+
+const uint8_t u8g2_font_4x6_tr[] = {4, 6};
+const uint8_t u8g2_font_miranda_nbp_tr[] = {5, 10};
+const uint8_t u8g2_font_prospero_bold_nbp_tr[] = {6, 11};
+const uint8_t u8g2_font_open_iconic_embedded_1x_t[] = {8, 8};
+const uint8_t u8g2_font_open_iconic_gui_1x_t[] = {8, 8};
+
+void U8G2::clearBuffer() {
+  std::fill(std::begin(_buffer), std::end(_buffer), 0);
+}
+
+void U8G2::sendBuffer() {
+  _tilesSent += TILE_WIDTH * TILE_HEIGHT;
+}
+
+void U8G2::updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th) {
+  _tilesSent += tw * th;
+}
+
+void U8G2::drawPixel(int x, int y) {
+  if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return;
+  uint8_t& byte = _buffer[(y / 8) * WIDTH + x];
+  const uint8_t bit = uint8_t(1 << (y % 8));
+  switch (_drawColor) {
+    case 0: byte &= uint8_t(~bit); break;
+    case 1: byte |= bit; break;
+    default: byte ^= bit; break;
+  }
+}
+
+void U8G2::drawHLine(int x, int y, int w) {
+  for (int i = 0; i < w; i++) drawPixel(x + i, y);
+}
+
+void U8G2::drawVLine(int x, int y, int h) {
+  for (int i = 0; i < h; i++) drawPixel(x, y + i);
+}
+
+void U8G2::drawLine(int x0, int y0, int x1, int y1) {
+  const int dx = abs(x1 - x0);
+  const int dy = -abs(y1 - y0);
+  const int sx = x0 < x1 ? 1 : -1;
+  const int sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  for (;;) {
+    drawPixel(x0, y0);
+    if (x0 == x1 && y0 == y1) break;
+    const int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x0 += sx; }
+    if (e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+void U8G2::drawBox(int x, int y, int w, int h) {
+  for (int i = 0; i < h; i++) drawHLine(x, y + i, w);
+}
+
+void U8G2::drawFrame(int x, int y, int w, int h) {
+  if (w <= 0 || h <= 0) return;
+  drawHLine(x, y, w);
+  drawHLine(x, y + h - 1, w);
+  drawVLine(x, y, h);
+  drawVLine(x + w - 1, y, h);
+}
+
+int U8G2::getStrWidth(const char* str) const {
+  return _font ? int(strlen(str)) * _font[0] : 0;
+}
+
+int U8G2::drawGlyph(int x, int y, uint16_t encoding) {
+  if (!_font) return 0;
+  const int width = _font[0];
+  const int height = _font[1];
+  const int top = _fontPosTop ? y : y - height + 1;
+  for (int col = 0; col < width - 1; col++) {
+    const uint32_t bits = (encoding * 2654435761U) >> (col * 5);
+    for (int row = 0; row < height; row++) {
+      if (bits & (1U << (row % 16))) drawPixel(x + col, top + row);
+    }
+  }
+  return width;
+}
+
+int U8G2::drawStr(int x, int y, const char* str) {
+  int width = 0;
+  while (*str) width += drawGlyph(x + width, y, uint8_t(*str++));
+  return width;
+}
+
+size_t U8G2::write(uint8_t c) {
+  if (c == '\n' || c == '\r') return 1;
+  _cursorX += drawGlyph(_cursorX, _cursorY, c);
+  return 1;
+}
@@ -0,0 +1,35 @@
+#include <stdio.h>
+
+#include <Print.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t count = 0;
+  while (size--) count += write(*buffer++);
+  return count;
+}
+
+size_t Print::printSigned(long long n, int base) {
+  if (n < 0 && base == DEC) {
+    return print('-') + printNumber((unsigned long long)(-(n + 1)) + 1, base);
+  }
+  return printNumber((unsigned long long)n, base);
+}
+
+size_t Print::printNumber(unsigned long long n, int base) {
+  if (base < 2) base = DEC;
+  char buffer[65];
+  char* p = &buffer[sizeof(buffer) - 1];
+  *p = '\0';
+  do {
+    const int digit = int(n % base);
+    *--p = char(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    n /= base;
+  } while (n);
+  return write(p);
+}
+
+size_t Print::printFloat(double n, int digits) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return write(buffer);
+}
@@ -0,0 +1,123 @@
+// Time library stand-in that keeps time from millis() like the original.
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+namespace {
+time_t sysTime = 0;
+uint32_t prevMillis = 0;
+time_t nextSyncTime = 0;
+time_t syncInterval = 300;
+timeStatus_t status = timeNotSet;
+getExternalTime getTime = nullptr;
+
+tmElements_t cacheElements;
+time_t cacheTime = -1;
+
+void refreshCache(time_t t) {
+  if (t != cacheTime) {
+    breakTime(t, cacheElements);
+    cacheTime = t;
+  }
+}
+} // namespace
+
+time_t now() {
+  while (millis() - prevMillis >= 1000) {
+    sysTime++;
+    prevMillis += 1000;
+  }
+  if (nextSyncTime <= sysTime) {
+    if (getTime) {
+      time_t t = getTime();
+      if (t != 0) {
+        setTime(t);
+      } else {
+        nextSyncTime = sysTime + syncInterval;
+        status = status == timeNotSet ? timeNotSet : timeNeedsSync;
+      }
+    }
+  }
+  return sysTime;
+}
+
+void setTime(time_t t) {
+  sysTime = t;
+  nextSyncTime = t + syncInterval;
+  status = timeSet;
+  prevMillis = millis();
+}
+
+void setTime(int hr, int min, int sec, int dy, int mnth, int yr) {
+  tmElements_t tm;
+  if (yr > 99) {
+    yr = yr - 1970;
+  } else {
+    yr += 30;
+  }
+  tm.Year = uint8_t(yr);
+  tm.Month = uint8_t(mnth);
+  tm.Day = uint8_t(dy);
+  tm.Hour = uint8_t(hr);
+  tm.Minute = uint8_t(min);
+  tm.Second = uint8_t(sec);
+  setTime(makeTime(tm));
+}
+
+void adjustTime(long adjustment) { sysTime += adjustment; }
+
+timeStatus_t timeStatus() {
+  now();
+  return status;
+}
+
+void setSyncProvider(getExternalTime getTimeFunction) {
+  getTime = getTimeFunction;
+  nextSyncTime = sysTime;
+  now();
+}
+
+void setSyncInterval(time_t interval) {
+  syncInterval = interval;
+  nextSyncTime = sysTime + syncInterval;
+}
+
+void breakTime(time_t time, tmElements_t& tm) {
+  struct tm t;
+  gmtime_r(&time, &t);
+  tm.Second = uint8_t(t.tm_sec);
+  tm.Minute = uint8_t(t.tm_min);
+  tm.Hour = uint8_t(t.tm_hour);
+  tm.Wday = uint8_t(t.tm_wday + 1);
+  tm.Day = uint8_t(t.tm_mday);
+  tm.Month = uint8_t(t.tm_mon + 1);
+  tm.Year = uint8_t(t.tm_year - 70);
+}
+
+time_t makeTime(const tmElements_t& tm) {
+  struct tm t = {};
+  t.tm_sec = tm.Second;
+  t.tm_min = tm.Minute;
+  t.tm_hour = tm.Hour;
+  t.tm_mday = tm.Day;
+  t.tm_mon = tm.Month - 1;
+  t.tm_year = tm.Year + 70;
+  return timegm(&t);
+}
+
+int hour() { return hour(now()); }
+int hour(time_t t) { refreshCache(t); return cacheElements.Hour; }
+int hourFormat12() { return hourFormat12(now()); }
+int hourFormat12(time_t t) { int h = hour(t) % 12; return h ? h : 12; }
+int minute() { return minute(now()); }
+int minute(time_t t) { refreshCache(t); return cacheElements.Minute; }
+int second() { return second(now()); }
+int second(time_t t) { refreshCache(t); return cacheElements.Second; }
+int day() { return day(now()); }
+int day(time_t t) { refreshCache(t); return cacheElements.Day; }
+int weekday() { return weekday(now()); }
+int weekday(time_t t) { refreshCache(t); return cacheElements.Wday; }
+int month() { return month(now()); }
+int month(time_t t) { refreshCache(t); return cacheElements.Month; }
+int year() { return year(now()); }
+int year(time_t t) { refreshCache(t); return tmYearToCalendar(cacheElements.Year); }
@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <TimeLib.h>
+
+#include "battery.h"
+#include "test.h"
+
+namespace {
+constexpr int VBAT_PIN = A6;
+constexpr time_t INTERVAL = BatteryHistory::INTERVAL;
+
+ChargerState chargerState = ChargerState::DISCHARGING;
+
+Battery battery(VBAT_PIN);
+ChargeEstimator chargeEstimator(&battery,
+    []() -> microamp_t { return 0; },
+    []() { return chargerState; });
+
+// Another instance over the same storage stands in for a restart.
+BatteryHistory makeHistory() {
+  return BatteryHistory(&battery, &chargeEstimator, BatteryHistory::Storage(1000),
+      BatteryHistory::SummaryStorage(1256), BatteryHistory::SummaryStorage(1616),
+      BatteryHistory::ChargeStorage(520));
+}
+
+BatteryHistory history = makeHistory();
+
+void setBattery(millivolt_t voltage) {
+  sim::setAnalogMillivolts(VBAT_PIN, voltage / 2); // halved by the divider
+  battery.reset();
+}
+
+// Records a sample at the start of each period in [first, end).
+void sample(uint32_t first, uint32_t end) {
+  for (uint32_t index = first; index < end; index++) {
+    setTime(time_t(index) * INTERVAL);
+    history.update();
+  }
+}
+
+// Starts with a ring full of samples at the given voltage.
+// Returns the index of the next period, which begins a block.
+uint32_t fillHistory(millivolt_t voltage) {
+  const uint32_t first = uint32_t(sim::DEFAULT_START_TIME / INTERVAL)
+      / BatteryHistory::LENGTH * BatteryHistory::LENGTH;
+  setTime(time_t(first) * INTERVAL);
+  battery.begin();
+  setBattery(voltage);
+  history.begin();
+  sample(first + 1, first + BatteryHistory::LENGTH);
+  return first + BatteryHistory::LENGTH;
+}
+} // namespace
+
+TEST(clockJumpMarksSkippedSamplesMissing) {
+  const uint32_t start = fillHistory(4200);
+  setBattery(3700);
+  const millivolt_t expected = battery.read();
+
+  // Jump forward two hours in the middle of a block.
+  sample(start, start + 4);
+  sample(start + 12, start + 16);
+
+  for (uint32_t index = start; index < start + 16; index++) {
+    const uint32_t period = index % BatteryHistory::LENGTH;
+    if (index >= start + 4 && index < start + 12) {
+      EXPECT_EQ(history.getAt(period), 3000); // missing
+      EXPECT_TRUE(BatteryHistory::isMissing(
+          history.getAt(BatteryHistory::Tier::SAMPLES, period)));
+    } else {
+      EXPECT_NEAR(history.getAt(period), expected, 10);
+    }
+  }
+}
+
+TEST(clockJumpPastTheRingClearsEverySample) {
+  const uint32_t start = fillHistory(4200);
+  setBattery(3700);
+  const millivolt_t expected = battery.read();
+
+  const uint32_t index = start + BatteryHistory::LENGTH * 3 + 7;
+  sample(index, index + 1);
+
+  for (uint32_t period = 0; period < BatteryHistory::LENGTH; period++) {
+    if (period == index % BatteryHistory::LENGTH) {
+      EXPECT_NEAR(history.getAt(period), expected, 10);
+    } else {
+      EXPECT_EQ(history.getAt(period), 3000);
+    }
+  }
+}
+
+TEST(restartDuringPeriodKeepsChargeLog) {
+  const uint32_t start = fillHistory(4000);
+  chargerState = ChargerState::POWERED;
+  for (time_t t = 0; t <= 5 * 60; t += 60) {
+    setTime(time_t(start) * INTERVAL + t);
+    history.update();
+  }
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0).powered, 5);
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 1).powered, 0);
+
+  BatteryHistory restarted = makeHistory();
+  restarted.begin();
+  EXPECT_EQ(restarted.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0).powered, 5);
+  EXPECT_EQ(restarted.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 1).powered, 0);
+
+  for (time_t t = 6 * 60; t <= 10 * 60; t += 60) {
+    setTime(time_t(start) * INTERVAL + t);
+    restarted.update();
+  }
+  EXPECT_EQ(restarted.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0).powered, 9);
+  chargerState = ChargerState::DISCHARGING;
+}
+
+TEST(chargeLogIsWrittenOncePerPeriod) {
+  const uint32_t start = fillHistory(4000);
+  const eeprom_addr_t addr = 520 + start % BatteryHistory::LENGTH;
+  chargerState = ChargerState::CHARGING;
+  for (time_t t = 0; t < INTERVAL; t += 60) {
+    setTime(time_t(start) * INTERVAL + t);
+    history.update();
+  }
+  const BatteryHistory::ChargeMinutes minutes =
+      history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0);
+  EXPECT_EQ(minutes.charging, 14);
+  EXPECT_EQ(minutes.powered, 14);
+  EXPECT_EQ(Settings::read<uint8_t>(addr), 0);
+
+  setTime(time_t(start + 1) * INTERVAL);
+  history.update();
+  EXPECT_EQ(Settings::read<uint8_t>(addr), 0xff);
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 1).charging, 15);
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0).charging, 0);
+  chargerState = ChargerState::DISCHARGING;
+}
+
+TEST(chargeMinutesCountBackFromTheGivenTime) {
+  const uint32_t start = fillHistory(4000);
+  chargerState = ChargerState::CHARGING;
+  for (time_t t = 0; t < INTERVAL; t += 60) {
+    setTime(time_t(start) * INTERVAL + t);
+    history.update();
+  }
+  const time_t snapshot = now();
+
+  // The snapshot still sees the charging period as the current one after
+  // the clock moves on to the next period.
+  chargerState = ChargerState::DISCHARGING;
+  setTime(time_t(start + 1) * INTERVAL);
+  history.update();
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0, snapshot).charging, 15);
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 1, snapshot).charging, 0);
+  EXPECT_EQ(history.getChargeMinutes(BatteryHistory::Tier::SAMPLES, 0).charging, 0);
+}
@@ -0,0 +1,81 @@
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+#include "battery.h"
+#include "test.h"
+
+namespace {
+constexpr int VBAT_PIN = A6;
+
+Battery battery(VBAT_PIN);
+
+ChargeEstimator makeEstimator() {
+  return ChargeEstimator(&battery,
+      []() -> microamp_t { return 0; },
+      []() { return ChargerState::DISCHARGING; });
+}
+
+void setBattery(millivolt_t voltage) {
+  sim::setAnalogMillivolts(VBAT_PIN, voltage / 2); // halved by the divider
+  battery.reset();
+}
+
+// Gets the state of charge that the estimate settles on at the voltage.
+int settledPercent(millivolt_t voltage) {
+  setBattery(voltage);
+  ChargeEstimator estimator = makeEstimator();
+  estimator.update();
+  return estimator.percent();
+}
+
+// Starts an estimate at one voltage then switches to another.
+void start(ChargeEstimator& estimator, millivolt_t from, millivolt_t to) {
+  setBattery(from);
+  estimator.update();
+  setBattery(to);
+}
+
+void updateEverySecond(ChargeEstimator& estimator, time_t start, uint32_t seconds) {
+  for (uint32_t i = 1; i <= seconds; i++) {
+    setTime(start + i);
+    estimator.update();
+  }
+}
+} // namespace
+
+TEST(chargeEstimateSmoothsOverTheTimeConstant) {
+  battery.begin();
+  const int from = settledPercent(3770);
+  const int to = settledPercent(3850);
+  EXPECT_GE(to - from, 15);
+
+  // After one time constant, about 63% of the way there.
+  const int expected = from + (to - from) * 632 / 1000;
+  ChargeEstimator everySecond = makeEstimator();
+  const time_t t = now();
+  start(everySecond, 3770, 3850);
+  updateEverySecond(everySecond, t, 600);
+  EXPECT_NEAR(everySecond.percent(), expected, 1);
+
+  ChargeEstimator once = makeEstimator();
+  setTime(t);
+  start(once, 3770, 3850);
+  setTime(t + 600);
+  once.update();
+  EXPECT_NEAR(once.percent(), everySecond.percent(), 1);
+}
+
+TEST(chargeEstimateTracksSmallChangesOneSecondAtATime) {
+  battery.begin();
+  const int from = settledPercent(3770);
+  const int to = settledPercent(3776);
+  EXPECT_GE(to - from, 1);
+
+  ChargeEstimator estimator = makeEstimator();
+  const time_t t = now();
+  start(estimator, 3770, 3776);
+  updateEverySecond(estimator, t, 6000);
+  EXPECT_EQ(estimator.percent(), to);
+}
@@ -0,0 +1,81 @@
+#include <math.h>
+
+#include "test.h"
+#include "utils.h"
+
+namespace {
+// The float formulas that the color tables were generated from.
+
+uint8_t referenceScaleAndClamp(float t, float scale) {
+  t *= scale;
+  if (t <= 0.1f) return 0;
+  if (t >= 255.f) return 255;
+  if (t <= 1.f) return 1;
+  return uint8_t(roundf(t));
+}
+
+RGB referenceKnobColor(tint_t tint, tone_t tone, brightness_t brightness) {
+  const float scale = brightness * 0.1f;
+  if (tint == TINT_WHITE) {
+    return RGB{
+      referenceScaleAndClamp(253.f, scale),
+      referenceScaleAndClamp(244.f, scale),
+      referenceScaleAndClamp(220.f, scale)
+    };
+  }
+  const uint8_t pos = uint32_t(tint) * 255 / 36;
+  const RGB color = RGB::colorWheel(pos);
+  const float alpha = tone * 0.1f;
+  const float beta = 1.f - alpha;
+  return RGB{
+    referenceScaleAndClamp(color.r * alpha + 255.f * beta, scale),
+    referenceScaleAndClamp(color.g * alpha + 255.f * beta, scale),
+    referenceScaleAndClamp(color.b * alpha + 255.f * beta, scale)
+  };
+}
+
+RGBW referenceStripColor(tint_t tint, tone_t tone, brightness_t brightness) {
+  const float scale = powf(brightness * 0.1f, 2.5f);
+  if (tint == TINT_WHITE) {
+    return RGBW{0, 0, 0, referenceScaleAndClamp(210.f, scale)};
+  }
+  const uint8_t pos = uint32_t(tint) * 255 / 36;
+  const RGB color = RGB::colorWheel(pos);
+  const float alpha = 0.4f + tone * 0.06f;
+  const float beta = 0.6f - tone * 0.06f;
+  return RGBW{
+    referenceScaleAndClamp(color.r * alpha, scale),
+    referenceScaleAndClamp(color.g * alpha, scale),
+    referenceScaleAndClamp(color.b * alpha, scale),
+    referenceScaleAndClamp(255.f * beta, scale),
+  };
+}
+} // namespace
+
+TEST(knobColorsMatchFloatFormula) {
+  unsigned mismatches = 0;
+  for (unsigned tint = TINT_MIN; tint <= TINT_MAX; tint++) {
+    for (unsigned tone = TONE_MIN; tone <= TONE_MAX; tone++) {
+      for (unsigned brightness = BRIGHTNESS_MIN; brightness <= BRIGHTNESS_MAX; brightness++) {
+        if (makeKnobColor(tint, tone, brightness) != referenceKnobColor(tint, tone, brightness)) {
+          mismatches++;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(mismatches, 0u);
+}
+
+TEST(stripColorsMatchFloatFormula) {
+  unsigned mismatches = 0;
+  for (unsigned tint = TINT_MIN; tint <= TINT_MAX; tint++) {
+    for (unsigned tone = TONE_MIN; tone <= TONE_MAX; tone++) {
+      for (unsigned brightness = BRIGHTNESS_MIN; brightness <= BRIGHTNESS_MAX; brightness++) {
+        if (makeStripColor(tint, tone, brightness) != referenceStripColor(tint, tone, brightness)) {
+          mismatches++;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(mismatches, 0u);
+}
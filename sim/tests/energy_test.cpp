@@ -0,0 +1,50 @@
+#include "energy.h"
+#include "test.h"
+
+TEST(stripCurrentLimitFollowsVoltageSteps) {
+  EXPECT_EQ(stripCurrentLimit(4200), STRIP_CURRENT_LIMIT_HIGH);
+  EXPECT_EQ(stripCurrentLimit(3300), STRIP_CURRENT_LIMIT_LOW);
+  EXPECT_EQ(stripCurrentLimit(3650), stripCurrentLimit(3600));
+  EXPECT_LT(stripCurrentLimit(3699), stripCurrentLimit(3700));
+}
+
+TEST(stripCurrentLimitDropsImmediately) {
+  const microamp_t high = stripCurrentLimit(3700);
+  EXPECT_EQ(stripCurrentLimit(3699, high), stripCurrentLimit(3600));
+}
+
+TEST(stripCurrentLimitRisesOnlyAfterRecovering) {
+  const microamp_t low = stripCurrentLimit(3699);
+  EXPECT_EQ(stripCurrentLimit(3700, low), low);
+  EXPECT_EQ(stripCurrentLimit(3749, low), low);
+  EXPECT_EQ(stripCurrentLimit(3750, low), stripCurrentLimit(3700));
+}
+
+TEST(stripCurrentLimitDoesNotPumpAroundAStep) {
+  // The voltage sags by 20 mV while the strip draws the higher limit.
+  microamp_t limit = STRIP_CURRENT_LIMIT_HIGH;
+  unsigned changes = 0;
+  for (unsigned i = 0; i < 100; i++) {
+    const uint32_t millivolts = limit > stripCurrentLimit(3699) ? 3690 : 3710;
+    const microamp_t next = stripCurrentLimit(millivolts, limit);
+    if (next != limit) changes++;
+    limit = next;
+  }
+  EXPECT_LE(changes, 1u);
+}
+
+TEST(rampStripCurrentScaleStepsTowardsTarget) {
+  EXPECT_EQ(rampStripCurrentScale(SCALE8_ONE, SCALE8_ONE), SCALE8_ONE);
+  EXPECT_EQ(rampStripCurrentScale(SCALE8_ONE, 0), SCALE8_ONE - STRIP_CURRENT_SCALE_STEP);
+  EXPECT_EQ(rampStripCurrentScale(0, SCALE8_ONE), STRIP_CURRENT_SCALE_STEP);
+  EXPECT_EQ(rampStripCurrentScale(100, 101), 101);
+  EXPECT_EQ(rampStripCurrentScale(101, 100), 100);
+
+  scale8_t scale = SCALE8_ONE;
+  unsigned steps = 0;
+  while (scale != 0) {
+    scale = rampStripCurrentScale(scale, 0);
+    steps++;
+  }
+  EXPECT_EQ(steps, unsigned(SCALE8_ONE / STRIP_CURRENT_SCALE_STEP));
+}
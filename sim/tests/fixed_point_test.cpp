@@ -0,0 +1,88 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "utils.h"
+
+namespace {
+int referenceScaleAndClamp(float t, float scale) {
+  t *= scale;
+  if (t <= 0.1f) return 0;
+  if (t >= 255.f) return 255;
+  if (t <= 1.f) return 1;
+  return int(roundf(t));
+}
+} // namespace
+
+TEST(toScale8RoundsAndSaturates) {
+  EXPECT_EQ(toScale8(-1.f), 0);
+  EXPECT_EQ(toScale8(0.f), 0);
+  EXPECT_EQ(toScale8(1.f), SCALE8_ONE);
+  EXPECT_EQ(toScale8(0.5f / SCALE8_ONE), 1);
+  EXPECT_EQ(toScale8(1000.f), 0xffff);
+  for (unsigned i = 0; i <= 4000; i++) {
+    const float scale = i * 0.001f;
+    EXPECT_NEAR(toScale8(scale), scale * SCALE8_ONE, 0.5f);
+  }
+}
+
+TEST(scaleAndClamp8IsWithinOneOfFloat) {
+  // The scale is quantized in steps of 1/256 so it can be off by up to
+  // 1/512, which moves the product by half a step on top of rounding, but
+  // never by more than one step.
+  int worst = 0;
+  for (unsigned i = 0; i <= 1000; i++) {
+    const float scale = i * 0.001f;
+    for (unsigned value = 0; value <= 255; value++) {
+      const int error = abs(scaleAndClamp8(value, toScale8(scale))
+          - referenceScaleAndClamp(value, scale));
+      if (error > worst) worst = error;
+    }
+  }
+  EXPECT_LE(worst, 1);
+}
+
+TEST(gamma25IsWithinOneAndAHalfLsbOfFloat) {
+  EXPECT_EQ(gamma25(0), 0u);
+  EXPECT_EQ(gamma25(FRACT16_ONE), FRACT16_ONE);
+  EXPECT_EQ(gamma25(FRACT16_ONE * 2), FRACT16_ONE);
+  double worst = 0;
+  for (fract16_t x = 0; x <= FRACT16_ONE; x++) {
+    const double expected = pow(double(x) / FRACT16_ONE, 2.5) * FRACT16_ONE;
+    const double error = fabs(gamma25(x) - expected);
+    if (error > worst) worst = error;
+  }
+  EXPECT_LE(worst, 1.5);
+}
+
+TEST(scaleAndClamp8IsExactForExactScales) {
+  for (unsigned scale = 0; scale <= 2 * SCALE8_ONE; scale++) {
+    for (unsigned value = 0; value <= 255; value++) {
+      EXPECT_EQ(scaleAndClamp8(value, scale),
+          referenceScaleAndClamp(value, float(scale) / SCALE8_ONE));
+    }
+  }
+}
+
+TEST(lerp8IsWithinHalfAStepOfFloat) {
+  for (unsigned a = 0; a <= 255; a += 5) {
+    for (unsigned b = 0; b <= 255; b += 3) {
+      for (unsigned t = 0; t <= SCALE8_ONE; t++) {
+        const float expected = a + (float(b) - float(a)) * t / SCALE8_ONE;
+        EXPECT_NEAR(lerp8(a, b, t), expected, 0.5f);
+      }
+      EXPECT_EQ(lerp8(a, b, 0), a);
+      EXPECT_EQ(lerp8(a, b, SCALE8_ONE), b);
+    }
+  }
+}
+
+TEST(colorTablesClampOutOfRangeArguments) {
+  EXPECT_TRUE(makeKnobColor(TINT_MAX + 10, TONE_MAX, BRIGHTNESS_MAX)
+      == makeKnobColor(TINT_MAX, TONE_MAX, BRIGHTNESS_MAX));
+  EXPECT_TRUE(makeKnobColor(TINT_MIN, TONE_MAX + 1, BRIGHTNESS_MAX + 5)
+      == makeKnobColor(TINT_MIN, TONE_MAX, BRIGHTNESS_MAX));
+  EXPECT_TRUE(makeStripColor(3, 0, 4) == makeStripColor(3, TONE_MIN, 4));
+  EXPECT_TRUE(makeStripColor(200, 200, 200)
+      == makeStripColor(TINT_MAX, TONE_MAX, BRIGHTNESS_MAX));
+}
@@ -0,0 +1,36 @@
+#include "lights.h"
+#include "test.h"
+
+namespace {
+constexpr RGBW WARM{0, 0, 40, 200};
+} // namespace
+
+TEST(fadeReachesTargetAfterDuration) {
+  Fade fade;
+  fade.setTarget(WARM, 1000, 0);
+  EXPECT_TRUE(fade.isFading(500));
+  EXPECT_TRUE(fade.color(500) == (RGBW{0, 0, 20, 100}));
+  EXPECT_FALSE(fade.isFading(1000));
+  EXPECT_TRUE(fade.color(1000) == WARM);
+}
+
+TEST(fadeIgnoresSameTarget) {
+  Fade fade;
+  fade.setTarget(WARM, 1000, 0);
+  fade.setTarget(WARM, 1000, 900);
+  EXPECT_TRUE(fade.color(1000) == WARM);
+}
+
+TEST(resetFadesInFromOffAgain) {
+  // Like recovering from the low battery cutoff with the same target as before.
+  Fade fade;
+  fade.setTarget(WARM, 1000, 0);
+  fade.reset(RGBW{});
+  EXPECT_TRUE(fade.color(5000) == RGBW{});
+
+  fade.setTarget(WARM, 1000, 5000);
+  EXPECT_TRUE(fade.isFading(5000));
+  EXPECT_TRUE(fade.color(5000) == RGBW{});
+  EXPECT_TRUE(fade.color(5500) == (RGBW{0, 0, 20, 100}));
+  EXPECT_TRUE(fade.color(6000) == WARM);
+}
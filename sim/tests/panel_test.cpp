@@ -0,0 +1,91 @@
+#include <string.h>
+
+#include <Arduino.h>
+#include <Snooze.h>
+
+#include "panel.h"
+#include "stats.h"
+#include "test.h"
+
+namespace {
+constexpr int BTN_EN1 = 15;
+constexpr int BTN_EN2 = 16;
+
+Panel panel;
+SnoozeDigital snoozeDigital;
+
+Panel& beginPanel() {
+  static bool begun = false;
+  if (!begun) {
+    panel.begin(snoozeDigital);
+    begun = true;
+  }
+  panel.readKnobRotations();
+  return panel;
+}
+
+Counter& droppedSteps() {
+  for (Stat* stat = Stat::first(); stat; stat = stat->next()) {
+    if (!strcmp(stat->name(), "Knob steps dropped")) {
+      return *static_cast<Counter*>(stat);
+    }
+  }
+  abort();
+}
+
+// Schedules the four quadrature edges of one detent starting at the given time.
+void scheduleStep(uint64_t time, uint64_t edgeMicros, int direction) {
+  const int first = direction > 0 ? BTN_EN1 : BTN_EN2;
+  const int second = direction > 0 ? BTN_EN2 : BTN_EN1;
+  sim::schedulePin(time, first, LOW);
+  sim::schedulePin(time + edgeMicros, second, LOW);
+  sim::schedulePin(time + edgeMicros * 2, first, HIGH);
+  sim::schedulePin(time + edgeMicros * 3, second, HIGH);
+}
+} // namespace
+
+TEST(countsEveryStepAtHighRates) {
+  Panel& panel = beginPanel();
+  droppedSteps().reset();
+
+  // 2000 detents per second, far faster than a hand can turn the knob,
+  // reversing direction every 100 detents.
+  constexpr unsigned STEPS = 2000;
+  constexpr uint64_t STEP_MICROS = 500;
+  const uint64_t start = sim::elapsedMicros() + 1000;
+  int32_t expected = 0;
+  for (unsigned i = 0; i < STEPS; i++) {
+    const int direction = i / 100 % 2 ? -1 : 1;
+    scheduleStep(start + i * STEP_MICROS, STEP_MICROS / 4, direction);
+    expected += direction;
+  }
+
+  // Drain the queue as often as the UI task polls while active.
+  int32_t total = 0;
+  int32_t largest = 0;
+  while (sim::elapsedMicros() < start + STEPS * STEP_MICROS + 5000) {
+    sim::advanceMillis(5);
+    const int32_t rotations = panel.readKnobRotations();
+    total += rotations;
+    largest = std::max(largest, abs(rotations));
+  }
+
+  EXPECT_EQ(total, expected);
+  EXPECT_LE(largest, 11);
+  EXPECT_EQ(droppedSteps().value(), 0u);
+  EXPECT_TRUE(panel.canSleep());
+}
+
+TEST(countsStepsDroppedWhileTheLoopStalls) {
+  Panel& panel = beginPanel();
+  droppedSteps().reset();
+
+  const uint64_t start = sim::elapsedMicros() + 1000;
+  for (unsigned i = 0; i < 40; i++) {
+    scheduleStep(start + i * 400, 100, 1);
+  }
+  sim::advanceMillis(50);
+
+  EXPECT_EQ(panel.readKnobRotations(), 32);
+  EXPECT_EQ(droppedSteps().value(), 8u);
+}
@@ -0,0 +1,101 @@
+#include <string>
+
+#include <Arduino.h>
+#include <Print.h>
+
+#include "console.h"
+#include "energy.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "test.h"
+
+namespace {
+// Collects printed output to measure it.
+class StringPrint : public Print {
+public:
+  size_t write(uint8_t b) override {
+    text += char(b);
+    return 1;
+  }
+
+  std::string text;
+};
+
+template <typename PrintLine>
+size_t longestLine(unsigned lineCount, PrintLine printLine) {
+  size_t longest = 0;
+  for (unsigned line = 0; line < lineCount; line++) {
+    StringPrint out;
+    printLine(out, line);
+    longest = std::max(longest, out.text.size());
+  }
+  return longest;
+}
+
+millis_t idleTask() { return 1000; }
+
+// Stats register themselves for good so they can't be local to a test.
+Counter longCounter("A rather long counter");
+Histogram longHistogram("A rather long histogram");
+Histogram sparseHistogram("Sparse");
+} // namespace
+
+TEST(statLinesFitInAConsoleChunk) {
+  longCounter.add(UINT32_MAX);
+  longHistogram.add(0);
+  for (unsigned i = 0; i < 32; i++) {
+    longHistogram.add(1UL << i);
+    longHistogram.add(UINT32_MAX);
+  }
+  EXPECT_EQ(longHistogram.lineCount(), 2 + Histogram::BUCKETS);
+
+  for (Stat* stat = Stat::first(); stat; stat = stat->next()) {
+    const size_t longest = longestLine(stat->lineCount(), [&](Print& out, unsigned line) {
+      stat->printLine(out, line);
+    });
+    EXPECT_LE(longest, size_t(Console::CHUNK_SPACE));
+  }
+}
+
+TEST(histogramPrintsOnlyBucketsWithValues) {
+  sparseHistogram.reset();
+  sparseHistogram.add(3);
+  sparseHistogram.add(100);
+  sparseHistogram.add(100);
+  EXPECT_EQ(sparseHistogram.lineCount(), 4u);
+
+  StringPrint out;
+  for (unsigned line = 0; line < sparseHistogram.lineCount(); line++) {
+    sparseHistogram.printLine(out, line);
+  }
+  EXPECT_EQ(out.text, std::string("Sparse: n=3\r\n  mean=67 max=100\r\n  <4: 1\r\n  <128: 2\r\n"));
+}
+
+TEST(energyReportLinesFitInAConsoleChunk) {
+  EnergyMeter meter;
+  meter.begin();
+  meter.setLoad(EnergyMeter::Consumer::PANEL, 100000);
+  meter.setLoad(EnergyMeter::Consumer::STRIP, STRIP_CURRENT_LIMIT_HIGH);
+  for (unsigned i = 0; i < 60; i++) {
+    sim::advanceMillis(60000);
+    meter.update();
+  }
+
+  const size_t longest = longestLine(EnergyMeter::REPORT_LINES, [&](Print& out, unsigned line) {
+    meter.printReportLine(out, line);
+  });
+  EXPECT_LE(longest, size_t(Console::CHUNK_SPACE));
+}
+
+TEST(taskReportLinesFitInAConsoleChunk) {
+  Scheduler scheduler;
+  for (unsigned i = 0; i < Scheduler::MAX_TASKS; i++) {
+    scheduler.addTask("tenletters", idleTask);
+  }
+  scheduler.run();
+
+  const size_t longest = longestLine(scheduler.reportLineCount(), [&](Print& out, unsigned line) {
+    scheduler.printReportLine(out, line);
+  });
+  EXPECT_LE(longest, size_t(Console::CHUNK_SPACE));
+}
@@ -0,0 +1,74 @@
+#include <Arduino.h>
+
+#include "scheduler.h"
+#include "test.h"
+
+namespace {
+uint32_t fastRuns;
+uint32_t slowRuns;
+
+millis_t fastTask() {
+  fastRuns++;
+  return 10;
+}
+
+millis_t slowTask() {
+  slowRuns++;
+  return 250;
+}
+
+void handlePin() {}
+} // namespace
+
+TEST(runsTasksWhenDue) {
+  fastRuns = slowRuns = 0;
+  Scheduler scheduler;
+  scheduler.addTask("fast", fastTask);
+  scheduler.addTask("slow", slowTask);
+
+  const uint32_t start = millis();
+  while (millis() - start < 1000) {
+    scheduler.run();
+    scheduler.idle();
+  }
+  EXPECT_EQ(fastRuns, 100u);
+  EXPECT_EQ(slowRuns, 4u);
+}
+
+TEST(idlesUntilNextDeadline) {
+  fastRuns = slowRuns = 0;
+  Scheduler scheduler;
+  scheduler.addTask("slow", slowTask);
+  scheduler.run();
+
+  const uint32_t start = millis();
+  scheduler.idle();
+  EXPECT_EQ(millis() - start, 250u);
+}
+
+TEST(interruptEndsIdleEarly) {
+  Scheduler scheduler;
+  scheduler.addTask("slow", slowTask);
+  scheduler.run();
+
+  pinMode(15, INPUT_PULLUP);
+  attachInterrupt(15, handlePin, CHANGE);
+  sim::schedulePin(sim::elapsedMicros() + 42500, 15, LOW);
+
+  const uint32_t start = micros();
+  scheduler.idle();
+  EXPECT_EQ(micros() - start, 42500u);
+  detachInterrupt(15);
+}
+
+TEST(wakeMakesAllTasksDue) {
+  fastRuns = slowRuns = 0;
+  Scheduler scheduler;
+  scheduler.addTask("fast", fastTask);
+  scheduler.addTask("slow", slowTask);
+  scheduler.run();
+  scheduler.wake();
+  scheduler.run();
+  EXPECT_EQ(fastRuns, 2u);
+  EXPECT_EQ(slowRuns, 2u);
+}
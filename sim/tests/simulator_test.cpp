@@ -0,0 +1,86 @@
+#include <Arduino.h>
+#include <Snooze.h>
+#include <SnoozeBlock.h>
+#include <EEPROM.h>
+#include <TimeLib.h>
+
+#include "test.h"
+
+namespace {
+uint32_t interrupts;
+
+void countInterrupt() {
+  interrupts++;
+}
+} // namespace
+
+TEST(clocksAdvanceOnlyWhenWaiting) {
+  const uint32_t start = millis();
+  const time_t rtc = Teensy3Clock.get();
+  EXPECT_EQ(millis(), start);
+  delay(1500);
+  EXPECT_EQ(millis() - start, 1500u);
+  EXPECT_EQ(Teensy3Clock.get() - rtc, 1ul);
+  EXPECT_EQ(now(), time_t(rtc + 1));
+}
+
+TEST(sleepStopsMillisecondClockUntilAlarm) {
+  SnoozeDigital digital;
+  SnoozeAlarm alarm;
+  SnoozeBlock block(digital, alarm);
+  digital.pinMode(0, INPUT_PULLUP, CHANGE);
+  alarm.setRtcTimer(0, 15, 0);
+
+  const uint32_t start = millis();
+  const time_t rtc = Teensy3Clock.get();
+  EXPECT_EQ(Snooze.sleep(block), SNOOZE_SOURCE_RTC_ALARM);
+  EXPECT_EQ(millis(), start);
+  EXPECT_EQ(Teensy3Clock.get() - rtc, 900ul);
+}
+
+TEST(sleepEndsWhenWakePinChanges) {
+  SnoozeDigital digital;
+  SnoozeAlarm alarm;
+  SnoozeBlock block(digital, alarm);
+  digital.pinMode(1, INPUT_PULLUP, CHANGE);
+  alarm.setRtcTimer(1, 0, 0);
+
+  // Changes to other pins and changes that don't alter the level don't wake.
+  sim::schedulePin(sim::elapsedMicros() + 10000000, 2, LOW);
+  sim::schedulePin(sim::elapsedMicros() + 20000000, 1, HIGH);
+  sim::schedulePin(sim::elapsedMicros() + 30000000, 1, LOW);
+  const time_t rtc = Teensy3Clock.get();
+  EXPECT_EQ(Snooze.sleep(block), 1);
+  EXPECT_EQ(Teensy3Clock.get() - rtc, 30ul);
+  EXPECT_EQ(digitalRead(1), LOW);
+}
+
+TEST(interruptsRunOnMatchingEdges) {
+  interrupts = 0;
+  pinMode(3, INPUT_PULLUP);
+  attachInterrupt(3, countInterrupt, FALLING);
+  sim::setPin(3, LOW);
+  sim::setPin(3, HIGH);
+  sim::setPin(3, LOW);
+  EXPECT_EQ(interrupts, 2u);
+
+  // The hardware remembers one pending interrupt while they are disabled.
+  __disable_irq();
+  sim::setPin(3, HIGH);
+  sim::setPin(3, LOW);
+  sim::setPin(3, HIGH);
+  sim::setPin(3, LOW);
+  EXPECT_EQ(interrupts, 2u);
+  __enable_irq();
+  EXPECT_EQ(interrupts, 3u);
+  detachInterrupt(3);
+}
+
+TEST(eepromStartsErased) {
+  EXPECT_EQ(EEPROM.read(0), 0xff);
+  EEPROM.update(0, 0xff);
+  EXPECT_EQ(sim::eepromWriteCount(), 0u);
+  EEPROM.update(0, 1);
+  EXPECT_EQ(EEPROM.read(0), 1);
+  EXPECT_EQ(sim::eepromWriteCount(), 1u);
+}
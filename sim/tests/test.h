@@ -0,0 +1,80 @@
+/*
+ * Minimal test framework for the host simulation build.
+ *
+ * Each test runs on a freshly reset simulator.  Failed expectations are
+ * reported and the test continues so that one run shows every failure.
+ */
+
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "sim.h"
+
+namespace test {
+
+using TestFunction = void (*)();
+
+struct Registration {
+  Registration(const char* name, TestFunction function);
+};
+
+void fail(const char* file, int line, const std::string& message);
+
+template <typename T>
+typename std::enable_if<std::is_enum<T>::value, std::string>::type describe(const T& value) {
+  return std::to_string(static_cast<long long>(value));
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, std::string>::type describe(const T& value) {
+  std::ostringstream out;
+  out << +value;
+  return out.str();
+}
+
+inline std::string describe(const std::string& value) { return "\"" + value + "\""; }
+inline std::string describe(const char* value) { return describe(std::string(value)); }
+
+} // namespace test
+
+#define TEST(name) \
+  static void name(); \
+  static ::test::Registration name##Registration(#name, name); \
+  static void name()
+
+#define EXPECT_TRUE(condition) \
+  do { \
+    if (!(condition)) ::test::fail(__FILE__, __LINE__, "expected " #condition); \
+  } while (0)
+
+#define EXPECT_FALSE(condition) EXPECT_TRUE(!(condition))
+
+#define EXPECT_OP(a, op, b) \
+  do { \
+    const auto& _a = (a); \
+    const auto& _b = (b); \
+    if (!(_a op _b)) { \
+      ::test::fail(__FILE__, __LINE__, "expected " #a " " #op " " #b ", got " \
+          + ::test::describe(_a) + " and " + ::test::describe(_b)); \
+    } \
+  } while (0)
+
+#define EXPECT_EQ(a, b) EXPECT_OP(a, ==, b)
+#define EXPECT_NE(a, b) EXPECT_OP(a, !=, b)
+#define EXPECT_LT(a, b) EXPECT_OP(a, <, b)
+#define EXPECT_LE(a, b) EXPECT_OP(a, <=, b)
+#define EXPECT_GT(a, b) EXPECT_OP(a, >, b)
+#define EXPECT_GE(a, b) EXPECT_OP(a, >=, b)
+
+#define EXPECT_NEAR(a, b, tolerance) \
+  do { \
+    const double _a = (a); \
+    const double _b = (b); \
+    if (!(_a - _b <= (tolerance) && _b - _a <= (tolerance))) { \
+      ::test::fail(__FILE__, __LINE__, "expected " #a " within " #tolerance " of " #b \
+          ", got " + ::test::describe(_a) + " and " + ::test::describe(_b)); \
+    } \
+  } while (0)
@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+struct Test {
+  const char* name;
+  test::TestFunction function;
+};
+
+std::vector<Test>& tests() {
+  static std::vector<Test> tests;
+  return tests;
+}
+
+unsigned failures = 0;
+} // namespace
+
+test::Registration::Registration(const char* name, TestFunction function) {
+  tests().push_back(Test{name, function});
+}
+
+void test::fail(const char* file, int line, const std::string& message) {
+  fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+  failures++;
+}
+
+int main() {
+  unsigned failedTests = 0;
+  for (const Test& test : tests()) {
+    sim::reset();
+    const unsigned before = failures;
+    test.function();
+    const bool passed = failures == before;
+    printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+    if (!passed) failedTests++;
+  }
+  printf("%u of %zu tests failed\n", failedTests, tests().size());
+  return failedTests ? 1 : 0;
+}